@@ -0,0 +1,365 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "object/bvh.h"
+#include "object/constant_medium.h"
+#include "object/hittable.h"
+#include "object/hittable_list.h"
+#include "object/instance.h"
+#include "object/linear_bvh.h"
+#include "object/rotate.h"
+#include "object/translate.h"
+#include "object/wide_bvh.h"
+#include "utility/aabb.h"
+
+// Tools for judging BVH builders and layouts by the trees they produce
+// rather than by render time alone.
+
+// A BVH of any layout as a plain tree, so that one set of metrics and one
+// dump format cover them all.
+struct BvhView {
+  struct Node {
+    Aabb box;
+    // Indices of the child nodes; empty for leaves.
+    std::vector<int> children;
+    // Primitives of a leaf.
+    long primitive_count{};
+    int depth{};
+  };
+
+  std::string layout;
+  // The root first.
+  std::vector<Node> nodes;
+  // Every primitive of the BVH, to look for BVHs nested in them.
+  std::vector<const Hittable*> primitives;
+};
+
+// Fills `view` and returns true when `object` is a BvhNode, LinearBvh or
+// WideBvh.
+bool ViewBvh(const Hittable& object, BvhView* view);
+
+// A BVH of a scene, with the path of objects leading to it from the world.
+struct SceneBvh {
+  std::string path;
+  BvhView view;
+};
+
+// Finds the BVHs of `world`, including those nested in other BVHs, lists,
+// instances, transforms and media. BVHs shared by several instances are
+// listed once.
+std::vector<SceneBvh> FindBvhs(const HittableList& world);
+
+struct BvhMetrics {
+  long interior_nodes{};
+  long leaves{};
+  long primitives{};
+  int max_depth{};
+  // Average depth of the leaves, weighted by their primitive counts.
+  double average_primitive_depth{};
+  // Average children per interior node.
+  double average_branching{};
+  // Number of leaves of each primitive count.
+  std::map<long, long> leaf_sizes;
+  // Expected cost of tracing a ray under the surface area heuristic, with
+  // the options' traversal and intersection costs.
+  double sah_cost{};
+  // Surface area of the overlaps between sibling boxes relative to their
+  // parent's, summed over every pair of siblings and averaged over the
+  // interior nodes. Zero when no siblings overlap.
+  double average_sibling_overlap{};
+};
+
+BvhMetrics AnalyzeBvh(const BvhView& view, const BvhBuildOptions& options);
+
+void WriteBvhMetrics(std::ostream& out, const BvhMetrics& metrics);
+
+// Writes the tree as one JSON object with its path, its layout and one node
+// per line, each with its box, depth, children and primitive count.
+void WriteBvhJson(std::ostream& out, const SceneBvh& bvh);
+
+// Appends the subtree of `object`, a BvhNode or one of its leaves, and
+// returns the index of its root.
+int ViewBvhNode(const Hittable& object, int depth, BvhView* view) {
+  auto index = static_cast<int>(view->nodes.size());
+  view->nodes.emplace_back();
+  view->nodes[index].depth = depth;
+  if (const auto* node = dynamic_cast<const BvhNode*>(&object)) {
+    view->nodes[index].box = node->box_;
+    // The median builder puts a range of one object in both children.
+    auto left = ViewBvhNode(*node->left_, depth + 1, view);
+    view->nodes[index].children.push_back(left);
+    if (node->right_ != node->left_) {
+      auto right = ViewBvhNode(*node->right_, depth + 1, view);
+      view->nodes[index].children.push_back(right);
+    }
+    return index;
+  }
+
+  // Leaves are lists of primitives or a single primitive.
+  object.BoundingBox(0, 1, &view->nodes[index].box);
+  if (const auto* list = dynamic_cast<const HittableList*>(&object)) {
+    view->nodes[index].primitive_count =
+        static_cast<long>(list->objects_.size());
+    for (const auto& primitive : list->objects_) {
+      view->primitives.push_back(primitive.get());
+    }
+  } else {
+    view->nodes[index].primitive_count = 1;
+    view->primitives.push_back(&object);
+  }
+  return index;
+}
+
+void ViewLinearBvh(const LinearBvh& bvh, BvhView* view) {
+  const auto& nodes = bvh.Nodes();
+  view->nodes.resize(nodes.size());
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    const auto& node = nodes[i];
+    auto& view_node = view->nodes[i];
+    view_node.box =
+        Aabb(Point3(node.bounds[0][0], node.bounds[0][1], node.bounds[0][2]),
+             Point3(node.bounds[1][0], node.bounds[1][1], node.bounds[1][2]));
+    if (node.primitive_count > 0) {
+      view_node.primitive_count = node.primitive_count;
+      continue;
+    }
+    // Children come after their parent, so its depth is already known.
+    view_node.children = {static_cast<int>(i) + 1, node.offset};
+    for (auto child : view_node.children) {
+      view->nodes[child].depth = view_node.depth + 1;
+    }
+  }
+  for (const auto& object : bvh.Objects()) {
+    view->primitives.push_back(object.get());
+  }
+}
+
+// Appends wide node `index` and its subtree, with every leaf child as a
+// node of its own, and returns the index of the appended node.
+template <int kWidth, bool kMotion>
+int ViewWideBvhNode(const WideBvh<kWidth, kMotion>& bvh, int index, int depth,
+                    BvhView* view) {
+  const auto& node = bvh.Nodes()[index];
+  auto view_index = static_cast<int>(view->nodes.size());
+  view->nodes.emplace_back();
+  view->nodes[view_index].depth = depth;
+
+  Aabb box;
+  for (int c = 0; c < kWidth && (node.child[c] >= 0 || node.count[c] > 0);
+       ++c) {
+    // Motion nodes cover their children's boxes at time0 and time1.
+    Point3 min;
+    Point3 max;
+    for (int a = 0; a < 3; ++a) {
+      min[a] = node.bounds[0][0][a][c];
+      max[a] = node.bounds[0][1][a][c];
+      if constexpr (kMotion) {
+        min[a] = std::fmin(min[a], min[a] + node.bounds[1][0][a][c]);
+        max[a] = std::fmax(max[a], max[a] + node.bounds[1][1][a][c]);
+      }
+    }
+    Aabb child_box(min, max);
+    box = c == 0 ? child_box : Aabb::SurroundingBox(box, child_box);
+
+    int child;
+    if (node.count[c] > 0) {
+      child = static_cast<int>(view->nodes.size());
+      view->nodes.emplace_back();
+      view->nodes[child].depth = depth + 1;
+      view->nodes[child].primitive_count = node.count[c];
+    } else {
+      child = ViewWideBvhNode(bvh, node.child[c], depth + 1, view);
+    }
+    view->nodes[child].box = child_box;
+    view->nodes[view_index].children.push_back(child);
+  }
+  view->nodes[view_index].box = box;
+  return view_index;
+}
+
+template <int kWidth, bool kMotion>
+void ViewWideBvh(const WideBvh<kWidth, kMotion>& bvh, BvhView* view) {
+  if (!bvh.Nodes().empty()) {
+    ViewWideBvhNode(bvh, 0, 0, view);
+  }
+  for (const auto& object : bvh.Objects()) {
+    view->primitives.push_back(object.get());
+  }
+}
+
+bool ViewBvh(const Hittable& object, BvhView* view) {
+  *view = BvhView();
+  if (const auto* bvh = dynamic_cast<const BvhNode*>(&object)) {
+    view->layout = "tree";
+    ViewBvhNode(*bvh, 0, view);
+  } else if (const auto* bvh = dynamic_cast<const LinearBvh*>(&object)) {
+    view->layout = "linear";
+    ViewLinearBvh(*bvh, view);
+  } else if (const auto* bvh = dynamic_cast<const Bvh4*>(&object)) {
+    view->layout = "bvh4";
+    ViewWideBvh(*bvh, view);
+  } else if (const auto* bvh = dynamic_cast<const Bvh8*>(&object)) {
+    view->layout = "bvh8";
+    ViewWideBvh(*bvh, view);
+  } else if (const auto* bvh = dynamic_cast<const MotionBvh4*>(&object)) {
+    view->layout = "motion bvh4";
+    ViewWideBvh(*bvh, view);
+  } else if (const auto* bvh = dynamic_cast<const MotionBvh8*>(&object)) {
+    view->layout = "motion bvh8";
+    ViewWideBvh(*bvh, view);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void FindBvhsIn(const Hittable& object, const std::string& path,
+                std::set<const Hittable*>* visited,
+                std::vector<SceneBvh>* bvhs) {
+  if (!visited->insert(&object).second) {
+    return;
+  }
+  BvhView view;
+  if (ViewBvh(object, &view)) {
+    auto primitives = view.primitives;
+    bvhs->push_back({path, std::move(view)});
+    for (size_t i = 0; i < primitives.size(); ++i) {
+      FindBvhsIn(*primitives[i], path + "/" + std::to_string(i), visited,
+                 bvhs);
+    }
+  } else if (const auto* list = dynamic_cast<const HittableList*>(&object)) {
+    for (size_t i = 0; i < list->objects_.size(); ++i) {
+      FindBvhsIn(*list->objects_[i], path + "/" + std::to_string(i), visited,
+                 bvhs);
+    }
+  } else if (const auto* instance = dynamic_cast<const Instance*>(&object)) {
+    FindBvhsIn(*instance->Geometry(), path + "/instance", visited, bvhs);
+  } else if (const auto* translate = dynamic_cast<const Translate*>(&object)) {
+    FindBvhsIn(*translate->Object(), path + "/translate", visited, bvhs);
+  } else if (const auto* rotate = dynamic_cast<const RotateY*>(&object)) {
+    FindBvhsIn(*rotate->ptr_, path + "/rotate_y", visited, bvhs);
+  } else if (const auto* medium =
+                 dynamic_cast<const ConstantMedium*>(&object)) {
+    FindBvhsIn(*medium->boundary, path + "/medium", visited, bvhs);
+  }
+}
+
+std::vector<SceneBvh> FindBvhs(const HittableList& world) {
+  std::set<const Hittable*> visited;
+  std::vector<SceneBvh> bvhs;
+  FindBvhsIn(world, "world", &visited, &bvhs);
+  return bvhs;
+}
+
+BvhMetrics AnalyzeBvh(const BvhView& view, const BvhBuildOptions& options) {
+  BvhMetrics metrics;
+  if (view.nodes.empty()) {
+    return metrics;
+  }
+  auto root_area = view.nodes[0].box.SurfaceArea();
+  double overlap_sum = 0;
+  long branching_sum = 0;
+  long depth_sum = 0;
+
+  for (const auto& node : view.nodes) {
+    auto area = node.box.SurfaceArea();
+    auto weight = root_area > 0 ? area / root_area : 1;
+    metrics.max_depth = std::max(metrics.max_depth, node.depth);
+    if (node.children.empty()) {
+      ++metrics.leaves;
+      ++metrics.leaf_sizes[node.primitive_count];
+      metrics.primitives += node.primitive_count;
+      depth_sum += node.depth * node.primitive_count;
+      metrics.sah_cost +=
+          weight * node.primitive_count * options.intersection_cost;
+      continue;
+    }
+
+    ++metrics.interior_nodes;
+    branching_sum += static_cast<long>(node.children.size());
+    metrics.sah_cost += weight * options.traversal_cost;
+    if (area <= 0) {
+      continue;
+    }
+    double overlap = 0;
+    for (size_t i = 0; i < node.children.size(); ++i) {
+      for (size_t j = i + 1; j < node.children.size(); ++j) {
+        const auto& a = view.nodes[node.children[i]].box;
+        const auto& b = view.nodes[node.children[j]].box;
+        Point3 min;
+        Point3 max;
+        bool overlaps = true;
+        for (int axis = 0; axis < 3; ++axis) {
+          min[axis] = std::max(a.Minimum()[axis], b.Minimum()[axis]);
+          max[axis] = std::min(a.Maximum()[axis], b.Maximum()[axis]);
+          overlaps = overlaps && min[axis] < max[axis];
+        }
+        if (overlaps) {
+          overlap += Aabb(min, max).SurfaceArea();
+        }
+      }
+    }
+    overlap_sum += overlap / area;
+  }
+
+  if (metrics.primitives > 0) {
+    metrics.average_primitive_depth = static_cast<double>(depth_sum) /
+                                      static_cast<double>(metrics.primitives);
+  }
+  if (metrics.interior_nodes > 0) {
+    metrics.average_branching = static_cast<double>(branching_sum) /
+                                static_cast<double>(metrics.interior_nodes);
+    metrics.average_sibling_overlap =
+        overlap_sum / static_cast<double>(metrics.interior_nodes);
+  }
+  return metrics;
+}
+
+void WriteBvhMetrics(std::ostream& out, const BvhMetrics& metrics) {
+  out << "  interior nodes:          " << metrics.interior_nodes << '\n'
+      << "  leaves:                  " << metrics.leaves << '\n'
+      << "  primitives:              " << metrics.primitives << '\n'
+      << "  max depth:               " << metrics.max_depth << '\n'
+      << "  average primitive depth: " << metrics.average_primitive_depth
+      << '\n'
+      << "  average branching:       " << metrics.average_branching << '\n'
+      << "  SAH cost:                " << metrics.sah_cost << '\n'
+      << "  sibling overlap:         " << metrics.average_sibling_overlap
+      << '\n'
+      << "  leaf sizes:              ";
+  for (const auto& [size, count] : metrics.leaf_sizes) {
+    out << size << ':' << count << ' ';
+  }
+  out << '\n';
+}
+
+void WriteBvhJson(std::ostream& out, const SceneBvh& bvh) {
+  auto point = [&out](const Point3& p) {
+    out << '[' << p.X() << ", " << p.Y() << ", " << p.Z() << ']';
+  };
+  out << "{\"path\": \"" << bvh.path << "\", \"layout\": \""
+      << bvh.view.layout << "\", \"nodes\": [\n";
+  for (size_t i = 0; i < bvh.view.nodes.size(); ++i) {
+    const auto& node = bvh.view.nodes[i];
+    out << "  {\"min\": ";
+    point(node.box.Minimum());
+    out << ", \"max\": ";
+    point(node.box.Maximum());
+    out << ", \"depth\": " << node.depth << ", \"children\": [";
+    for (size_t c = 0; c < node.children.size(); ++c) {
+      out << (c > 0 ? ", " : "") << node.children[c];
+    }
+    out << "], \"primitives\": " << node.primitive_count << '}'
+        << (i + 1 < bvh.view.nodes.size() ? "," : "") << '\n';
+  }
+  out << "]}";
+}
+
+#pragma endregion  // RAY_TRACING_ONE_WEEK_BVH_ANALYSIS_H
@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "analysis/bvh_analysis.h"
+#include "object/bvh.h"
+#include "object/camera.h"
+#include "object/hittable_list.h"
+#include "render/integrator.h"
+#include "scene/scene_registry.h"
+#include "utility/image_writer.h"
+#include "utility/parallel.h"
+#include "utility/rtweekend.h"
+#include "utility/stats.h"
+
+// Reports the quality of every BVH of a scene, and optionally dumps the
+// trees and renders a heatmap of BVH nodes visited per sample. Built with
+// RT_ENABLE_STATS, which the heatmap reads its counts from.
+
+// Maps t in [0, 1] from blue through green to red.
+Color HeatColor(double t) {
+  t = std::clamp(t, 0.0, 1.0);
+  if (t < 0.5) {
+    return {0, 2 * t, 1 - 2 * t};
+  }
+  return {2 * t - 1, 2 - 2 * t, 0};
+}
+
+// Renders `world` at `samples_per_pixel` and stores, per pixel, the average
+// number of BVH nodes its samples visited.
+std::vector<double> TraversalHeatmap(const HittableList& world, int width,
+                                     int height, int samples_per_pixel,
+                                     int max_depth, int thread_count) {
+  std::vector<double> visits(width * height);
+  const auto& camera = *world.camera_;
+  ParallelFor(0, height, thread_count, [&](int, long first, long last) {
+    auto& stats = Stats::Local();
+    for (auto j = first; j < last; ++j) {
+      for (int i = 0; i < width; ++i) {
+        auto before = stats.bvh_nodes_visited;
+        for (int s = 0; s < samples_per_pixel; ++s) {
+          // The same samples as the renderer takes.
+          Sampler sampler(static_cast<int>(j) * width + i, s);
+          auto u = (i + sampler.Next()) / (width - 1);
+          auto v = (j + sampler.Next()) / (height - 1);
+          Ray ray = camera.GetRay(u, v, &sampler);
+          RayColor(ray, camera.background_, world, max_depth, &sampler);
+        }
+        visits[j * width + i] =
+            static_cast<double>(stats.bvh_nodes_visited - before) /
+            samples_per_pixel;
+      }
+    }
+  });
+  return visits;
+}
+
+int main() {
+  // Camera
+  auto camera = std::make_shared<Camera>(
+      Point3(13.0, 2.0, 3.0), Point3(0, 0, 0), Vec3(0, 1, 0), 20.0,
+      16.0 / 9.0, 0.1, 10.0, Color(0.70, 0.80, 1.00), 0.0f, 1.0f);
+
+  std::string scene_name = "Random";
+  std::string dump_file;
+  std::string heatmap_file;
+  int image_width = 400;
+  int samples_per_pixel = 4;
+  const int max_depth = 50;
+  int thread_count = static_cast<int>(std::thread::hardware_concurrency());
+  auto& bvh_options = DefaultBvhBuildOptions();
+
+  // Read Environment Variables
+  if (const char* env_p = std::getenv("SCENE")) {
+    scene_name = env_p;
+  }
+  if (const char* env_p = std::getenv("BVH_DUMP")) {
+    dump_file = env_p;
+  }
+  if (const char* env_p = std::getenv("HEATMAP")) {
+    heatmap_file = env_p;
+  }
+  if (const char* env_p = std::getenv("IMAGE_WIDTH")) {
+    image_width = std::stoi(env_p);
+  }
+  if (const char* env_p = std::getenv("SPP")) {
+    samples_per_pixel = std::stoi(env_p);
+  }
+  if (const char* env_p = std::getenv("THREADS")) {
+    thread_count = std::stoi(env_p);
+  }
+  if (const char* env_p = std::getenv("BVH_BUILDER")) {
+    if (!ParseBvhBuilder(env_p, &bvh_options.builder)) {
+      std::cerr << "BVH builder " << env_p << " not found" << std::endl;
+      return 1;
+    }
+  }
+  if (const char* env_p = std::getenv("BVH_LAYOUT")) {
+    if (!ParseBvhLayout(env_p, &bvh_options.layout)) {
+      std::cerr << "BVH layout " << env_p << " not found" << std::endl;
+      return 1;
+    }
+  }
+  if (const char* env_p = std::getenv("BVH_BINS")) {
+    bvh_options.bin_count = std::stoi(env_p);
+  }
+  if (const char* env_p = std::getenv("BVH_LEAF_SIZE")) {
+    bvh_options.max_leaf_size = std::stoi(env_p);
+  }
+  if (const char* env_p = std::getenv("BVH_CACHE")) {
+    bvh_options.cache_directory = env_p;
+  }
+  bvh_options.thread_count = thread_count;
+
+  const auto& scenes = DefaultSceneRegistry();
+  if (!scenes.Contains(scene_name)) {
+    std::cerr << "Scene " << scene_name << " not found" << std::endl;
+    return 1;
+  }
+  auto world = scenes.Build(scene_name, camera);
+
+  // Metrics
+  auto bvhs = FindBvhs(world);
+  std::cout << "Scene " << scene_name << ": " << bvhs.size() << " BVHs"
+            << std::endl;
+  for (const auto& bvh : bvhs) {
+    std::cout << bvh.path << " (" << bvh.view.layout << ")\n";
+    WriteBvhMetrics(std::cout, AnalyzeBvh(bvh.view, bvh_options));
+  }
+
+  if (!dump_file.empty()) {
+    std::ofstream out(dump_file);
+    out << "[\n";
+    for (size_t i = 0; i < bvhs.size(); ++i) {
+      WriteBvhJson(out, bvhs[i]);
+      out << (i + 1 < bvhs.size() ? ",\n" : "\n");
+    }
+    out << "]\n";
+  }
+
+  // Heatmap
+  if (heatmap_file.empty()) {
+    return 0;
+  }
+  auto format = ImageFormat::kPpm;
+  auto extension = heatmap_file.substr(heatmap_file.rfind('.') + 1);
+  if (!ParseImageFormat(extension, &format)) {
+    std::cerr << "Output format " << extension << " not found" << std::endl;
+    return 1;
+  }
+  int image_height =
+      static_cast<int>(image_width / world.camera_->aspect_ratio_);
+  auto build_stats = Stats::Collect();
+  auto visits = TraversalHeatmap(world, image_width, image_height,
+                                 samples_per_pixel, max_depth, thread_count);
+  auto stats = Stats::Collect();
+  auto rays = stats.Rays() - build_stats.Rays();
+  long primitive_tests = 0;
+  for (int type = 0; type < kPrimitiveTypeCount; ++type) {
+    primitive_tests +=
+        stats.primitive_tests[type] - build_stats.primitive_tests[type];
+  }
+  auto per_ray = [rays](long count) {
+    return rays > 0 ? static_cast<double>(count) / rays : 0.0;
+  };
+  auto max_visits = *std::max_element(visits.begin(), visits.end());
+  std::cout << "Traced " << rays << " rays: "
+            << per_ray(stats.bvh_nodes_visited - build_stats.bvh_nodes_visited)
+            << " BVH nodes, "
+            << per_ray(stats.aabb_tests - build_stats.aabb_tests)
+            << " box tests and " << per_ray(primitive_tests)
+            << " primitive tests per ray; at most " << max_visits
+            << " nodes per sample in a pixel" << std::endl;
+
+  Image heatmap{image_width, image_height,
+                std::vector<Color>(image_width * image_height),
+                std::vector<int>(image_width * image_height, 1)};
+  for (size_t p = 0; p < visits.size(); ++p) {
+    heatmap.sums[p] =
+        HeatColor(max_visits > 0 ? visits[p] / max_visits : 0.0);
+  }
+  if (!ImageWriter::Write(heatmap_file, format, heatmap)) {
+    std::cerr << "ERROR: Could not write " << heatmap_file << std::endl;
+    return 1;
+  }
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Keeps the compiler from optimizing away a value a benchmark computes but
+// never uses.
+template <typename T>
+inline void DoNotOptimize(const T& value) {
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+// Timings of one benchmark. ns_per_op is the median over the repetitions,
+// which is less sensitive to the odd preempted run than the mean.
+struct BenchmarkResult {
+  std::string name;
+  long iterations{};
+  int repetitions{};
+  double ns_per_op{};
+  double min_ns_per_op{};
+  double max_ns_per_op{};
+
+  [[nodiscard]] double OpsPerSecond() const { return 1e9 / ns_per_op; }
+};
+
+// Runs a benchmark body of the form body(iterations), which must perform
+// `iterations` operations. The iteration count is calibrated during warm-up
+// so that one repetition takes about min_seconds.
+class BenchmarkRunner {
+ public:
+  BenchmarkRunner(int repetitions, double min_seconds)
+      : repetitions_(std::max(repetitions, 1)), min_seconds_(min_seconds) {}
+
+  BenchmarkResult Run(const std::string& name,
+                      const std::function<void(long)>& body) const;
+
+ private:
+  static double Time(const std::function<void(long)>& body, long iterations) {
+    auto start = std::chrono::steady_clock::now();
+    body(iterations);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start)
+        .count();
+  }
+
+  int repetitions_;
+  double min_seconds_;
+};
+
+BenchmarkResult BenchmarkRunner::Run(
+    const std::string& name, const std::function<void(long)>& body) const {
+  // Warm-up doubles the iteration count until a run is long enough to time
+  // reliably, then scales it to the target duration.
+  long iterations = 1;
+  double seconds = Time(body, iterations);
+  while (seconds < min_seconds_ / 10 && iterations < (1L << 40)) {
+    iterations *= 2;
+    seconds = Time(body, iterations);
+  }
+  iterations = std::max(
+      1L, static_cast<long>(static_cast<double>(iterations) * min_seconds_ /
+                            std::max(seconds, 1e-9)));
+
+  std::vector<double> ns_per_op;
+  for (int repetition = 0; repetition < repetitions_; ++repetition) {
+    ns_per_op.push_back(Time(body, iterations) * 1e9 /
+                        static_cast<double>(iterations));
+  }
+  std::sort(ns_per_op.begin(), ns_per_op.end());
+
+  BenchmarkResult result;
+  result.name = name;
+  result.iterations = iterations;
+  result.repetitions = repetitions_;
+  result.ns_per_op = ns_per_op[ns_per_op.size() / 2];
+  result.min_ns_per_op = ns_per_op.front();
+  result.max_ns_per_op = ns_per_op.back();
+  return result;
+}
+
+// Writes one JSON object per line inside a JSON array, so that
+// ReadBaseline can read the file back without a JSON parser.
+void WriteBenchmarkJson(std::ostream& out,
+                        const std::vector<BenchmarkResult>& results) {
+  out << "[\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const auto& result = results[i];
+    out << "  {\"name\": \"" << result.name
+        << "\", \"ns_per_op\": " << result.ns_per_op
+        << ", \"min_ns_per_op\": " << result.min_ns_per_op
+        << ", \"max_ns_per_op\": " << result.max_ns_per_op
+        << ", \"ops_per_second\": " << result.OpsPerSecond()
+        << ", \"iterations\": " << result.iterations
+        << ", \"repetitions\": " << result.repetitions << "}"
+        << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  out << "]\n";
+}
+
+// Reads the name and ns_per_op of every benchmark in a file written by
+// WriteBenchmarkJson. Returns false if the file cannot be opened.
+bool ReadBaseline(const std::string& filename,
+                  std::vector<std::pair<std::string, double>>* baseline) {
+  std::ifstream in(filename);
+  if (!in) {
+    return false;
+  }
+  const std::string kName = "\"name\": \"";
+  const std::string kNsPerOp = "\"ns_per_op\": ";
+  std::string line;
+  while (std::getline(in, line)) {
+    auto name = line.find(kName);
+    auto ns_per_op = line.find(kNsPerOp);
+    if (name == std::string::npos || ns_per_op == std::string::npos) {
+      continue;
+    }
+    name += kName.size();
+    baseline->emplace_back(
+        line.substr(name, line.find('"', name) - name),
+        std::stod(line.substr(ns_per_op + kNsPerOp.size())));
+  }
+  return true;
+}
+
+// Prints how every result compares to its baseline and returns the number of
+// benchmarks that got slower by more than `threshold` (0.05 is 5%).
+int CompareToBaseline(
+    const std::vector<BenchmarkResult>& results,
+    const std::vector<std::pair<std::string, double>>& baseline,
+    double threshold) {
+  int regressions = 0;
+  for (const auto& result : results) {
+    auto it = std::find_if(
+        baseline.begin(), baseline.end(),
+        [&result](const auto& entry) { return entry.first == result.name; });
+    if (it == baseline.end()) {
+      std::cerr << result.name << ": not in baseline" << std::endl;
+      continue;
+    }
+    auto change = result.ns_per_op / it->second - 1;
+    auto regressed = change > threshold;
+    regressions += regressed ? 1 : 0;
+    std::cerr << result.name << ": " << it->second << " -> "
+              << result.ns_per_op << " ns/op (" << (change >= 0 ? "+" : "")
+              << change * 100 << "%)" << (regressed ? "  REGRESSION" : "")
+              << std::endl;
+  }
+  return regressions;
+}
+
+#pragma endregion  // RAY_TRACING_ONE_WEEK_BENCHMARK_H
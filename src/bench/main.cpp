@@ -0,0 +1,270 @@
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "bench/benchmark.h"
+#include "material/dispatch.h"
+#include "material/material_table.h"
+#include "material/texture/image_texture.h"
+#include "object/aa_rectangle.h"
+#include "object/box.h"
+#include "object/bvh.h"
+#include "object/camera.h"
+#include "object/hittable_list.h"
+#include "object/linear_bvh.h"
+#include "object/moving_sphere.h"
+#include "object/sphere.h"
+#include "object/wide_bvh.h"
+#include "utility/perlin.h"
+#include "utility/rtweekend.h"
+
+// Microbenchmarks of the intersection, traversal and shading kernels. Every
+// benchmark cycles through kInputCount inputs drawn from a fixed seed, so
+// runs on different builds measure exactly the same work.
+
+const int kInputCount = 1024;
+const uint32_t kInputSeed = 0x5EED;
+
+// Rays from points around the origin, at distance 3 to 5, aimed at points in
+// the cube [-1.5, 1.5]^3: a mix of hits and misses for unit-sized shapes.
+std::vector<Ray> MakeRays() {
+  std::vector<Ray> rays;
+  for (int i = 0; i < kInputCount; ++i) {
+    Sampler sampler(i, kInputSeed);
+    auto origin = RandomUnitVector(&sampler) * sampler.Next(3, 5);
+    Point3 target(sampler.Next(-1.5, 1.5), sampler.Next(-1.5, 1.5),
+                  sampler.Next(-1.5, 1.5));
+    rays.emplace_back(origin, target - origin, sampler.Next());
+  }
+  return rays;
+}
+
+std::vector<Point3> MakePoints(double min, double max) {
+  std::vector<Point3> points;
+  for (int i = 0; i < kInputCount; ++i) {
+    Sampler sampler(i, kInputSeed);
+    points.emplace_back(sampler.Next(min, max), sampler.Next(min, max),
+                        sampler.Next(min, max));
+  }
+  return points;
+}
+
+// kInputCount small spheres scattered through the cube [-2, 2]^3.
+HittableList MakeSpheres(const shared_ptr<Material>& material) {
+  HittableList spheres;
+  for (int i = 0; i < kInputCount; ++i) {
+    Sampler sampler(i, kInputSeed + 1);
+    Point3 center(sampler.Next(-2, 2), sampler.Next(-2, 2),
+                  sampler.Next(-2, 2));
+    spheres.Add(make_shared<Sphere>(center, 0.1, material));
+  }
+  return spheres;
+}
+
+// kInputCount small boxes scattered through the cube [-2, 2]^3.
+HittableList MakeBoxes(const shared_ptr<Material>& material) {
+  HittableList boxes;
+  for (int i = 0; i < kInputCount; ++i) {
+    Sampler sampler(i, kInputSeed + 2);
+    Point3 corner(sampler.Next(-2, 2), sampler.Next(-2, 2),
+                  sampler.Next(-2, 2));
+    boxes.Add(make_shared<Box>(corner, corner + Vec3(0.15, 0.15, 0.15),
+                               material));
+  }
+  return boxes;
+}
+
+// Body of a benchmark that intersects the fixed rays with `object`.
+std::function<void(long)> HitBenchmark(const std::vector<Ray>& rays,
+                                       const Hittable& object) {
+  return [&rays, &object](long iterations) {
+    HitRecord record;
+    for (long n = 0; n < iterations; ++n) {
+      auto hit = object.Hit(rays[n % kInputCount], 0.001, infinity, &record);
+      DoNotOptimize(hit);
+    }
+    DoNotOptimize(record);
+  };
+}
+
+// Body of a benchmark that tests whether the fixed rays are blocked by
+// `object` before t = 1, their target point.
+std::function<void(long)> OccludedBenchmark(const std::vector<Ray>& rays,
+                                            const Hittable& object) {
+  return [&rays, &object](long iterations) {
+    for (long n = 0; n < iterations; ++n) {
+      auto occluded = object.Occluded(rays[n % kInputCount], 0.001, 1);
+      DoNotOptimize(occluded);
+    }
+  };
+}
+
+int main() {
+  int repetitions = 5;
+  double min_seconds = 0.2;
+  double threshold = 0.05;
+  std::string filter;
+  std::string output_file;
+  std::string baseline_file;
+
+  // Read Environment Variables
+  if (const char* env_p = std::getenv("BENCH_FILTER")) {
+    filter = env_p;
+  }
+  if (const char* env_p = std::getenv("BENCH_REPETITIONS")) {
+    repetitions = std::stoi(env_p);
+  }
+  if (const char* env_p = std::getenv("BENCH_MIN_TIME")) {
+    min_seconds = std::stod(env_p);
+  }
+  if (const char* env_p = std::getenv("BENCH_OUTPUT")) {
+    output_file = env_p;
+  }
+  if (const char* env_p = std::getenv("BENCH_BASELINE")) {
+    baseline_file = env_p;
+  }
+  if (const char* env_p = std::getenv("BENCH_THRESHOLD")) {
+    threshold = std::stod(env_p);
+  }
+
+  // Inputs
+  auto rays = MakeRays();
+  auto points = MakePoints(-10, 10);
+  auto material = make_shared<Lambertian>(Color(0.5, 0.5, 0.5));
+  Sphere sphere(Point3(0, 0, 0), 1, material);
+  MovingSphere moving_sphere(Point3(0, -0.5, 0), Point3(0, 0.5, 0), 0, 1, 1,
+                             material);
+  XyRectangle rectangle(-1, 1, -1, 1, 0, material);
+  Box unit_box(Point3(-1, -1, -1), Point3(1, 1, 1), material);
+  Aabb box(Point3(-1, -1, -1), Point3(1, 1, 1));
+  Perlin perlin;
+  ImageTexture texture("resources/earth-map.jpg");
+  // Reached through the material table, as the integrators reach it.
+  const auto& diffuse = DefaultMaterialTable()[DefaultMaterialTable().Add(
+      make_shared<Lambertian>(Color(0.2, 0.3, 0.1)))];
+  HitRecord surface;
+  surface.normal = Vec3(0, 1, 0);
+
+  auto camera = std::make_shared<Camera>(
+      Point3(13, 2, 3), Point3(0, 0, 0), Vec3(0, 1, 0), 20, 16.0 / 9.0, 0.1,
+      10.0, Color(0.70, 0.80, 1.00), 0.0, 1.0);
+  auto spheres = MakeSpheres(material);
+  BvhBuildOptions bvh_options;
+  BvhNode bvh_tree(spheres, 0, 1, bvh_options);
+  LinearBvh linear_bvh(spheres, 0, 1, bvh_options);
+  Bvh4 bvh4(spheres, 0, 1, bvh_options);
+  Bvh8 bvh8(spheres, 0, 1, bvh_options);
+  auto boxes = MakeBoxes(material);
+  Bvh4 box_bvh4(boxes, 0, 1, bvh_options);
+
+  std::vector<std::pair<std::string, std::function<void(long)>>> benchmarks = {
+      {"Sphere::Hit", HitBenchmark(rays, sphere)},
+      {"MovingSphere::Hit", HitBenchmark(rays, moving_sphere)},
+      {"XyRectangle::Hit", HitBenchmark(rays, rectangle)},
+      {"Box::Hit", HitBenchmark(rays, unit_box)},
+      {"Aabb::Hit",
+       [&](long iterations) {
+         for (long n = 0; n < iterations; ++n) {
+           auto hit = box.Hit(rays[n % kInputCount], 0.001, infinity);
+           DoNotOptimize(hit);
+         }
+       }},
+      // The same SAH splits over the spheres in each layout.
+      {"BvhNode::Hit", HitBenchmark(rays, bvh_tree)},
+      {"LinearBvh::Hit", HitBenchmark(rays, linear_bvh)},
+      {"Bvh4::Hit", HitBenchmark(rays, bvh4)},
+      {"Bvh8::Hit", HitBenchmark(rays, bvh8)},
+      // SAH splits over boxes, whose leaves are tested with SIMD.
+      {"Bvh4::Hit (boxes)", HitBenchmark(rays, box_bvh4)},
+      {"BvhNode::Occluded", OccludedBenchmark(rays, bvh_tree)},
+      {"LinearBvh::Occluded", OccludedBenchmark(rays, linear_bvh)},
+      {"Bvh4::Occluded", OccludedBenchmark(rays, bvh4)},
+      {"Perlin::Noise",
+       [&](long iterations) {
+         for (long n = 0; n < iterations; ++n) {
+           auto noise = perlin.Noise(points[n % kInputCount]);
+           DoNotOptimize(noise);
+         }
+       }},
+      {"Perlin::Terb",
+       [&](long iterations) {
+         for (long n = 0; n < iterations; ++n) {
+           auto turbulence = perlin.Terb(points[n % kInputCount]);
+           DoNotOptimize(turbulence);
+         }
+       }},
+      {"ImageTexture::Value",
+       [&](long iterations) {
+         for (long n = 0; n < iterations; ++n) {
+           const auto& p = points[n % kInputCount];
+           auto color = texture.Value(p.X() / 20 + 0.5, p.Y() / 20 + 0.5, p);
+           DoNotOptimize(color);
+         }
+       }},
+      // A material call and a texture call, both virtual unless built with
+      // -DRT_STATIC_DISPATCH=ON.
+      {"MaterialScatter",
+       [&](long iterations) {
+         Sampler sampler(0, kInputSeed);
+         Color attenuation;
+         Ray scattered;
+         for (long n = 0; n < iterations; ++n) {
+           const auto& ray = rays[n % kInputCount];
+           surface.p = points[n % kInputCount];
+           auto hit = MaterialScatter(diffuse, ray, surface, &attenuation,
+                                      &scattered, &sampler);
+           DoNotOptimize(hit);
+           DoNotOptimize(attenuation);
+         }
+       }},
+      {"Camera::GetRay",
+       [&](long iterations) {
+         Sampler sampler(0, kInputSeed);
+         for (long n = 0; n < iterations; ++n) {
+           const auto& p = points[n % kInputCount];
+           auto ray = camera->GetRay(p.X() / 20 + 0.5, p.Y() / 20 + 0.5,
+                                     &sampler);
+           DoNotOptimize(ray);
+         }
+       }},
+  };
+
+  // Run
+  BenchmarkRunner runner(repetitions, min_seconds);
+  std::vector<BenchmarkResult> results;
+  for (const auto& [name, body] : benchmarks) {
+    if (name.find(filter) == std::string::npos) {
+      continue;
+    }
+    results.push_back(runner.Run(name, body));
+    const auto& result = results.back();
+    std::cerr << result.name << ": " << result.ns_per_op << " ns/op, "
+              << result.OpsPerSecond() << " ops/s" << std::endl;
+  }
+
+  // Output
+  if (output_file.empty()) {
+    WriteBenchmarkJson(std::cout, results);
+  } else {
+    std::ofstream out(output_file);
+    WriteBenchmarkJson(out, results);
+  }
+
+  if (!baseline_file.empty()) {
+    std::vector<std::pair<std::string, double>> baseline;
+    if (!ReadBaseline(baseline_file, &baseline)) {
+      std::cerr << "ERROR: Could not read baseline file '" << baseline_file
+                << "'." << std::endl;
+      return 1;
+    }
+    auto regressions = CompareToBaseline(results, baseline, threshold);
+    if (regressions > 0) {
+      std::cerr << regressions << " benchmarks regressed by more than "
+                << threshold * 100 << "%" << std::endl;
+      return 1;
+    }
+  }
+}
@@ -1,350 +1,152 @@
+#include <algorithm>
+#include <chrono>
 #include <fstream>
+#include <filesystem>
 #include <iomanip>
 #include <iostream>
-#include <map>
+#include <string>
+#include <memory>
+#include <thread>
 #include <utility>
+#include <vector>
 
-#include "material/diffuse_light.h"
-#include "material/solid_color.h"
-#include "material/texture/checker_texture.h"
-#include "material/texture/image_texture.h"
-#include "material/texture/noise_texture.h"
-#include "object/aa_rectangle.h"
-#include "object/box.h"
+#include "material/material_table.h"
 #include "object/bvh.h"
 #include "object/camera.h"
-#include "object/constant_medium.h"
 #include "object/hittable_list.h"
-#include "object/moving_sphere.h"
-#include "object/rotate.h"
-#include "object/sphere.h"
-#include "object/translate.h"
-#include "utility/color.h"
+#include "render/integrator.h"
+#include "render/pixel_estimate.h"
+#include "render/render_settings.h"
+#include "render/tile_scheduler.h"
+#include "render/wavefront.h"
+#include "scene/scene_registry.h"
+#include "utility/image_writer.h"
 #include "utility/rtweekend.h"
+#include "utility/stats.h"
 
-#pragma clang diagnostic push
-#pragma ide diagnostic ignored "misc-no-recursion"
-Color RayColor(const Ray& r, const Color& background, const Hittable& world,
-               int depth) {
-  HitRecord hit_record;
+Color RenderSample(int i, int j, int s, const RenderSettings& settings,
+                   const HittableList& world) {
+  Sampler sampler(j * settings.image_width + i, s);
+  auto u = (i + sampler.Next()) / (settings.image_width - 1);
+  auto v = (j + sampler.Next()) / (settings.image_height - 1);
 
-  // If we've exceeded the ray bounce limit, no more light is gathered.
-  if (depth <= 0) {
-    return {0, 0, 0};
-  }
-  // If the ray hits nothing, return the background color.
-  if (!world.Hit(r, 0.001, infinity, &hit_record)) {
-    return background;
-  }
+  auto camera = world.camera_;
+  Ray ray = camera->GetRay(u, v, &sampler);
+  auto background = camera->background_;
 
-  Ray scattered;
-  Color attenuation;
-  Color emitted =
-      hit_record.material->Emitted(hit_record.u, hit_record.v, hit_record.p);
+  return RayColor(ray, background, world, settings.max_depth, &sampler);
+}
 
-  if (!hit_record.material->Scatter(r, hit_record, &attenuation, &scattered)) {
-    return emitted;
+// Takes `count` more samples of pixel (i, j). Sample indices continue from
+// the ones already taken, so every sample keeps its own random stream.
+void SamplePixel(int i, int j, int count, const RenderSettings& settings,
+                 const HittableList& world, PixelEstimate* estimate) {
+  for (int s = 0; s < count; ++s) {
+    estimate->Add(RenderSample(i, j, estimate->count, settings, world));
   }
-
-  return emitted +
-         attenuation * RayColor(scattered, background, world, depth - 1);
 }
-#pragma clang diagnostic pop
-
-HittableList RandomScene(shared_ptr<Camera> camera, bool has_time = true,
-                         bool has_checker_texture = true) {
-  HittableList boxes;
-  HittableList world;
 
-  double time0 = 0.0f;
-  double time1 = 1.0f;
-  if (!has_time) {
-    time0 = 0.0f;
-    time1 = 0.0f;
+// Takes the requested samples one path after another, or as a batch when a
+// wavefront integrator is given.
+void TakeSamples(const std::vector<SampleRequest>& requests,
+                 const RenderSettings& settings, const HittableList& world,
+                 WavefrontIntegrator* wavefront) {
+  if (wavefront != nullptr) {
+    wavefront->Trace(requests);
+    return;
   }
-
-  if (has_checker_texture) {
-    auto checker =
-        make_shared<CheckTexture>(make_shared<SolidColor>(0.2f, 0.3f, 0.1f),
-                                  make_shared<SolidColor>(0.9f, 0.9f, 0.9f));
-    boxes.Add(make_shared<Sphere>(Point3(0, -1000, 0), 1000,
-                                  make_shared<Lambertian>(checker)));
-  } else {
-    auto ground_material = make_shared<Lambertian>(Color(0.5, 0.5, 0.5));
-    boxes.Add(make_shared<Sphere>(Point3(0, -1000, 0), 1000, ground_material));
+  for (const auto& request : requests) {
+    SamplePixel(request.i, request.j, request.count, settings, world,
+                request.estimate);
   }
+}
 
-  for (int a = -11; a < 11; a++) {
-    for (int b = -11; b < 11; b++) {
-      auto choose_mat = RandomDouble();
-      Point3 center(a + 0.9 * RandomDouble(), 0.2, b + 0.9 * RandomDouble());
-
-      if ((center - Point3(4, 0.2, 0)).Length() > 0.9) {
-        shared_ptr<Material> sphere_material;
-
-        if (choose_mat < 0.8) {
-          // diffuse
-          auto albedo = Color::Random() * Color::Random();
-          sphere_material = make_shared<Lambertian>(albedo);
-          auto center2 = center + Vec3(0, RandomDouble(0, 0.5), 0);
-          boxes.Add(make_shared<MovingSphere>(center, center2, time0, time1,
-                                              0.2, sphere_material));
-        } else if (choose_mat < 0.95) {
-          // metal
-          auto albedo = Color::Random(0.5, 1);
-          auto fuzz = RandomDouble(0, 0.5);
-          sphere_material = make_shared<Metal>(albedo, fuzz);
-          boxes.Add(make_shared<Sphere>(center, 0.2, sphere_material));
-        } else {
-          // glass
-          sphere_material = make_shared<Dielectric>(1.5);
-          boxes.Add(make_shared<Sphere>(center, 0.2, sphere_material));
+// Buffers a render thread reuses from tile to tile.
+struct TileScratch {
+  std::vector<PixelEstimate> estimates;
+  std::vector<SampleRequest> requests;
+  std::unique_ptr<WavefrontIntegrator> wavefront;
+};
+
+// Spends the tile's budget of samples_per_pixel samples per pixel where it is
+// needed: every pixel first takes adaptive_min_samples, then the pixels whose
+// display error is still above the threshold take further batches of that
+// size, round-robin, until they converge or the budget runs out.
+void SampleTileAdaptive(const Tile& tile, const RenderSettings& settings,
+                        const HittableList& world, TileScratch* scratch) {
+  auto tile_width = tile.x1 - tile.x0;
+  auto& estimates = scratch->estimates;
+  auto& requests = scratch->requests;
+  auto batch =
+      std::min(settings.adaptive_min_samples, settings.samples_per_pixel);
+  long budget = static_cast<long>(estimates.size()) *
+                settings.samples_per_pixel;
+  long spent = 0;
+
+  requests.clear();
+  for (int j = tile.y0; j < tile.y1; ++j) {
+    for (int i = tile.x0; i < tile.x1; ++i) {
+      auto& estimate = estimates[(j - tile.y0) * tile_width + (i - tile.x0)];
+      requests.push_back({i, j, batch, &estimate});
+      spent += batch;
+    }
+  }
+  TakeSamples(requests, settings, world, scratch->wavefront.get());
+
+  while (!requests.empty() && spent < budget) {
+    requests.clear();
+    for (int j = tile.y0; j < tile.y1 && spent < budget; ++j) {
+      for (int i = tile.x0; i < tile.x1 && spent < budget; ++i) {
+        auto& estimate = estimates[(j - tile.y0) * tile_width + (i - tile.x0)];
+        if (estimate.count >= settings.adaptive_max_samples ||
+            estimate.DisplayError() <= settings.adaptive_threshold) {
+          continue;
         }
+        auto count = static_cast<int>(
+            std::min<long>({batch,
+                            settings.adaptive_max_samples - estimate.count,
+                            budget - spent}));
+        requests.push_back({i, j, count, &estimate});
+        spent += count;
       }
     }
+    TakeSamples(requests, settings, world, scratch->wavefront.get());
   }
-
-  auto material1 = make_shared<Dielectric>(1.5);
-  boxes.Add(make_shared<Sphere>(Point3(0, 1, 0), 1.0, material1));
-
-  auto material2 = make_shared<Lambertian>(Color(0.4, 0.2, 0.1));
-  boxes.Add(make_shared<Sphere>(Point3(-4, 1, 0), 1.0, material2));
-
-  auto material3 = make_shared<Metal>(Color(0.7, 0.6, 0.5), 0.0);
-  boxes.Add(make_shared<Sphere>(Point3(4, 1, 0), 1.0, material3));
-
-  world.Add(make_shared<BvhNode>(boxes, 0, 1));
-
-  world.camera_ = std::move(camera);
-  return world;
-}
-
-HittableList TwoSpheres(shared_ptr<Camera> camera) {
-  HittableList objects;
-
-  auto checker =
-      make_shared<CheckTexture>(make_shared<SolidColor>(0.2f, 0.3f, 0.1f),
-                                make_shared<SolidColor>(0.9f, 0.9f, 0.9f));
-  objects.Add(make_shared<Sphere>(Point3(0, -10, 0), 10,
-                                  make_shared<Lambertian>(checker)));
-  objects.Add(make_shared<Sphere>(Point3(0, 10, 0), 10,
-                                  make_shared<Lambertian>(checker)));
-
-  objects.camera_ = std::move(camera);
-
-  return objects;
 }
 
-HittableList TwoPerlinSpheres(shared_ptr<Camera> camera) {
-  HittableList objects;
-
-  auto per_text = make_shared<NoiseTexture>(4);
-  objects.Add(make_shared<Sphere>(Point3(0, -1000, 0), 1000,
-                                  make_shared<Lambertian>(per_text)));
-  objects.Add(make_shared<Sphere>(Point3(0, 2, 0), 2,
-                                  make_shared<Lambertian>(per_text)));
-
-  objects.camera_ = std::move(camera);
-  return objects;
-}
-
-HittableList Earth(shared_ptr<Camera> camera) {
-  auto earth_texture = make_shared<ImageTexture>("resources/earth-map.jpg");
-  auto earth_surface = make_shared<Lambertian>(earth_texture);
-  auto globe = make_shared<Sphere>(Point3(0, 0, 0), 2, earth_surface);
-  auto world = HittableList(globe);
-
-  world.camera_ = std::move(camera);
-
-  return world;
-}
-
-HittableList SampleLight(std::shared_ptr<Camera>& camera) {
-  HittableList objects;
-  auto per_text = make_shared<NoiseTexture>(4);
-  objects.Add(make_shared<Sphere>(Point3(0, -1000, 0), 1000,
-                                  make_shared<Lambertian>(per_text)));
-  objects.Add(make_shared<Sphere>(Point3(0, 2, 0), 2,
-                                  make_shared<Lambertian>(per_text)));
-
-  auto diff_light = make_shared<DiffuseLight>(make_shared<SolidColor>(4, 4, 4));
-  objects.Add(make_shared<Sphere>(Point3(0, 7, 0), 2, diff_light));
-  objects.Add(make_shared<XyRectangle>(3, 5, 1, 3, -2, diff_light));
-
-  Point3 look_from(26.0, 3.0, 6.0);
-  Point3 look_at(0, 2, 0);
-  auto aperture = 0.01;
-
-  objects.camera_ =
-      make_shared<Camera>(look_from, look_at, camera->v_up_, camera->v_fov_,
-                          camera->aspect_ratio_, aperture, camera->focus_dist_);
-
-  return objects;
-}
-
-HittableList CornellBox(std::shared_ptr<Camera>& camera) {
-  HittableList objects;
-
-  auto red = std::make_shared<Lambertian>(Color(0.65, 0.05, 0.05));
-  auto white = std::make_shared<Lambertian>(Color(0.73, 0.73, 0.73));
-  auto green = std::make_shared<Lambertian>(Color(.12, .45, .15));
-  auto light = std::make_shared<DiffuseLight>(Color(15, 15, 15));
-
-  objects.Add(std::make_shared<YzRectangle>(0, 555, 0, 555, 555, green));
-  objects.Add(std::make_shared<YzRectangle>(0, 555, 0, 555, 0, red));
-  objects.Add(std::make_shared<XzRectangle>(213, 343, 227, 332, 554, light));
-  objects.Add(std::make_shared<XzRectangle>(0, 555, 0, 555, 0, white));
-  objects.Add(std::make_shared<XzRectangle>(0, 555, 0, 555, 555, white));
-  objects.Add(std::make_shared<XyRectangle>(0, 555, 0, 555, 555, white));
-
-  std::shared_ptr<Hittable> box1 =
-      std::make_shared<Box>(Point3(0, 0, 0), Point3(165, 330, 165), white);
-  box1 = make_shared<RotateY>(box1, 15);
-  box1 = make_shared<Translate>(box1, Vec3(265, 0, 295));
-  objects.Add(box1);
-
-  std::shared_ptr<Hittable> box2 =
-      std::make_shared<Box>(Point3(0, 0, 0), Point3(165, 165, 165), white);
-  box2 = make_shared<RotateY>(box2, -18);
-  box2 = make_shared<Translate>(box2, Vec3(130, 0, 65));
-  objects.Add(box2);
-
-  objects.camera_ = std::make_shared<Camera>(
-      Point3(278, 278, -800), Point3(278, 278, 0), camera->v_up_, 40, 1.0,
-      camera->aperture_, camera->focus_dist_, Color(0, 0, 0), 0, 0);
-
-  return objects;
-}
-
-HittableList CornellSmoke(std::shared_ptr<Camera>& camera) {
-  HittableList objects;
-
-  auto red = std::make_shared<Lambertian>(Color(0.65, 0.05, 0.05));
-  auto white = std::make_shared<Lambertian>(Color(0.73, 0.73, 0.73));
-  auto green = std::make_shared<Lambertian>(Color(.12, .45, .15));
-  auto light = std::make_shared<DiffuseLight>(Color(7, 7, 7));
-
-  objects.Add(std::make_shared<YzRectangle>(0, 555, 0, 555, 555, green));
-  objects.Add(std::make_shared<YzRectangle>(0, 555, 0, 555, 0, red));
-  objects.Add(std::make_shared<XzRectangle>(113, 443, 127, 432, 554, light));
-  objects.Add(std::make_shared<XzRectangle>(0, 555, 0, 555, 0, white));
-  objects.Add(std::make_shared<XzRectangle>(0, 555, 0, 555, 555, white));
-  objects.Add(std::make_shared<XyRectangle>(0, 555, 0, 555, 555, white));
-
-  std::shared_ptr<Hittable> box1 =
-      std::make_shared<Box>(Point3(0, 0, 0), Point3(165, 330, 165), white);
-  box1 = make_shared<RotateY>(box1, 15);
-  box1 = make_shared<Translate>(box1, Vec3(265, 0, 295));
-
-  std::shared_ptr<Hittable> box2 =
-      std::make_shared<Box>(Point3(0, 0, 0), Point3(165, 165, 165), white);
-  box2 = make_shared<RotateY>(box2, -18);
-  box2 = make_shared<Translate>(box2, Vec3(130, 0, 65));
-
-  objects.Add(make_shared<ConstantMedium>(box1, 0.01, Color(0, 0, 0)));
-  objects.Add(make_shared<ConstantMedium>(box2, 0.01, Color(1, 1, 1)));
-
-  objects.camera_ = std::make_shared<Camera>(
-      Point3(278, 278, -800), Point3(278, 278, 0), camera->v_up_, 40, 1.0,
-      camera->aperture_, camera->focus_dist_, Color(0, 0, 0), 0, 0);
-
-  return objects;
-}
-
-HittableList TheNextWeek(std::shared_ptr<Camera>& camera) {
-  HittableList boxes1;
-  auto ground = make_shared<Lambertian>(Color(0.48, 0.83, 0.53));
-
-  const int boxes_per_side = 20;
-  for (int i = 0; i < boxes_per_side; i++) {
-    for (int j = 0; j < boxes_per_side; j++) {
-      auto w = 100.0;
-      auto x0 = -1000.0 + i * w;
-      auto z0 = -1000.0 + j * w;
-      auto y0 = 0.0;
-      auto x1 = x0 + w;
-      auto y1 = RandomDouble(1, 101);
-      auto z1 = z0 + w;
-
-      boxes1.Add(
-          make_shared<Box>(Point3(x0, y0, z0), Point3(x1, y1, z1), ground));
+// Renders one tile into a scratch buffer owned by the calling thread and then
+// copies it into the frame buffer row by row, so the only writes to memory
+// shared with other threads are a single burst per tile row.
+void RenderTile(const Tile& tile, const RenderSettings& settings,
+                const HittableList& world, TileScratch* scratch, Color* fb,
+                int* sample_counts) {
+  auto tile_width = tile.x1 - tile.x0;
+  auto& estimates = scratch->estimates;
+  estimates.assign(tile_width * (tile.y1 - tile.y0), PixelEstimate());
+
+  if (settings.adaptive_threshold > 0) {
+    SampleTileAdaptive(tile, settings, world, scratch);
+  } else {
+    auto& requests = scratch->requests;
+    requests.clear();
+    for (int j = tile.y0; j < tile.y1; ++j) {
+      for (int i = tile.x0; i < tile.x1; ++i) {
+        requests.push_back(
+            {i, j, settings.samples_per_pixel,
+             &estimates[(j - tile.y0) * tile_width + (i - tile.x0)]});
+      }
     }
+    TakeSamples(requests, settings, world, scratch->wavefront.get());
   }
 
-  HittableList objects;
-
-  objects.Add(make_shared<BvhNode>(boxes1, 0, 1));
-
-  auto light = make_shared<DiffuseLight>(Color(7, 7, 7));
-  objects.Add(make_shared<XzRectangle>(123, 423, 147, 412, 554, light));
-
-  auto center1 = Point3(400, 400, 200);
-  auto center2 = center1 + Vec3(30, 0, 0);
-  auto moving_sphere_material = make_shared<Lambertian>(Color(0.7, 0.3, 0.1));
-  objects.Add(make_shared<MovingSphere>(center1, center2, 0, 1, 50,
-                                        moving_sphere_material));
-
-  objects.Add(make_shared<Sphere>(Point3(260, 150, 45), 50,
-                                  make_shared<Dielectric>(1.5)));
-  objects.Add(make_shared<Sphere>(
-      Point3(0, 150, 145), 50, make_shared<Metal>(Color(0.8, 0.8, 0.9), 1.0)));
-
-  auto boundary = make_shared<Sphere>(Point3(360, 150, 145), 70,
-                                      make_shared<Dielectric>(1.5));
-  objects.Add(boundary);
-  objects.Add(make_shared<ConstantMedium>(boundary, 0.2, Color(0.2, 0.4, 0.9)));
-  boundary =
-      make_shared<Sphere>(Point3(0, 0, 0), 5000, make_shared<Dielectric>(1.5));
-  objects.Add(make_shared<ConstantMedium>(boundary, .0001, Color(1, 1, 1)));
-
-  auto e_mat = make_shared<Lambertian>(
-      make_shared<ImageTexture>("resources/earth-map.jpg"));
-  objects.Add(make_shared<Sphere>(Point3(400, 200, 400), 100, e_mat));
-  auto per_text = make_shared<NoiseTexture>(0.1);
-  objects.Add(make_shared<Sphere>(Point3(220, 280, 300), 80,
-                                  make_shared<Lambertian>(per_text)));
-
-  HittableList boxes2;
-  auto white = make_shared<Lambertian>(Color(.73, .73, .73));
-  int ns = 1000;
-  for (int j = 0; j < ns; j++) {
-    boxes2.Add(make_shared<Sphere>(Point3::Random(0, 165), 10, white));
-  }
-
-  objects.Add(make_shared<Translate>(
-      make_shared<RotateY>(make_shared<BvhNode>(boxes2, 0.0, 1.0), 15),
-      Vec3(-100, 270, 395)));
-
-  auto new_camera = std::make_shared<Camera>(
-      Point3(478, 278, -600), Point3(278, 278, 0), camera->v_up_, 40, 1.0,
-      camera->aperture_, camera->focus_dist_, Color(0, 0, 0), 0, 1);
-
-  camera = new_camera;
-
-  return objects;
-}
-
-void Render(unsigned int i, unsigned int j, Vec3* fb, int image_width,
-            int image_height, const HittableList& world, int max_depth,
-            int samples_per_pixel) {
-  if ((i >= image_width) || (j >= image_height)) {
-    return;
-  }
-  Color pixel_color(0, 0, 0);
-  auto camera = world.camera_;
-
-  for (int s = 0; s < samples_per_pixel; ++s) {
-    auto u = (i + RandomDouble()) / (image_width - 1);
-    auto v = (j + RandomDouble()) / (image_height - 1);
-
-    Ray ray = camera->GetRay(u, v);
-    auto background = camera->background_;
-
-    pixel_color += RayColor(ray, background, world, max_depth);
+  for (int j = tile.y0; j < tile.y1; ++j) {
+    for (int i = tile.x0; i < tile.x1; ++i) {
+      const auto& estimate =
+          estimates[(j - tile.y0) * tile_width + (i - tile.x0)];
+      fb[j * settings.image_width + i] = estimate.sum;
+      sample_counts[j * settings.image_width + i] = estimate.count;
+    }
   }
-
-  unsigned int pixel_index = j * image_width + i;
-  fb[pixel_index] = pixel_color;
 }
 
 int main(int argc, char** argv) {
@@ -361,25 +163,31 @@ int main(int argc, char** argv) {
                                          aspect_ratio, aperture, dist_to_focus,
                                          Color(0.70, 0.80, 1.00), 0.0f, 1.0f);
 
-  // World
-  auto world_map = std::map<std::string, HittableList>{
-      {"Random", RandomScene(camera, false, false)},
-      {"WithTime", RandomScene(camera, true, false)},
-      {"CheckerTexture", RandomScene(camera, true, true)},
-      {"TwoSpheres", TwoSpheres(camera)},
-      {"TwoPerlinSpheres", TwoPerlinSpheres(camera)},
-      {"Earth", Earth(camera)},
-      {"SampleLight", SampleLight(camera)},
-      {"CornellBox", CornellBox(camera)},
-      {"CornellSmoke", CornellSmoke(camera)},
-      {"TheNextWeek", TheNextWeek(camera)},
-  };
+  const auto& scenes = DefaultSceneRegistry();
+  if (argc > 1 && std::string(argv[1]) == "--list-scenes") {
+    for (const auto& name : scenes.Names()) {
+      std::cout << name << std::endl;
+    }
+    return 0;
+  }
 
   // Image
   int image_width = 1600;
   int samples_per_pixel = 500;
   const int max_depth = 50;
   std::string scene_name = "Random";
+  std::string mesh_file;
+  int thread_count = static_cast<int>(std::thread::hardware_concurrency());
+  int tile_size = 16;
+  double adaptive_threshold = 0;
+  int adaptive_min_samples = 16;
+  int adaptive_max_samples = 0;
+  std::string integrator = "path";
+  int wavefront_batch_size = 16384;
+  bool packets = false;
+  auto output_format = ImageFormat::kPpm;
+  std::string stats_file;
+  auto& bvh_options = DefaultBvhBuildOptions();
 
   // Read Environment Variables
   if (const char* env_p = std::getenv("SPP")) {
@@ -388,50 +196,188 @@ int main(int argc, char** argv) {
   if (const char* env_p = std::getenv("SCENE")) {
     scene_name = env_p;
   }
+  if (const char* env_p = std::getenv("MESH_FILE")) {
+    mesh_file = env_p;
+    scene_name = std::filesystem::path(mesh_file).stem().string();
+  }
   if (const char* env_p = std::getenv("IMAGE_WIDTH")) {
     image_width = std::stoi(env_p);
   }
+  if (const char* env_p = std::getenv("THREADS")) {
+    thread_count = std::stoi(env_p);
+  }
+  if (const char* env_p = std::getenv("TILE_SIZE")) {
+    tile_size = std::stoi(env_p);
+  }
+  if (const char* env_p = std::getenv("ADAPTIVE_THRESHOLD")) {
+    adaptive_threshold = std::stod(env_p);
+  }
+  if (const char* env_p = std::getenv("ADAPTIVE_MIN_SPP")) {
+    adaptive_min_samples = std::max(std::stoi(env_p), 2);
+  }
+  if (const char* env_p = std::getenv("ADAPTIVE_MAX_SPP")) {
+    adaptive_max_samples = std::stoi(env_p);
+  }
+  if (const char* env_p = std::getenv("INTEGRATOR")) {
+    integrator = env_p;
+  }
+  if (const char* env_p = std::getenv("WAVEFRONT_BATCH")) {
+    wavefront_batch_size = std::stoi(env_p);
+  }
+  if (const char* env_p = std::getenv("PACKETS")) {
+    packets = std::stoi(env_p) != 0;
+  }
+  if (const char* env_p = std::getenv("OUTPUT_FORMAT")) {
+    if (!ParseImageFormat(env_p, &output_format)) {
+      std::cerr << "Output format " << env_p << " not found" << std::endl;
+      return 1;
+    }
+  }
 
-  if (world_map.find(scene_name) == world_map.end()) {
-    std::cerr << "Scene " << scene_name << " not found" << std::endl;
+  if (const char* env_p = std::getenv("BVH_BUILDER")) {
+    if (!ParseBvhBuilder(env_p, &bvh_options.builder)) {
+      std::cerr << "BVH builder " << env_p << " not found" << std::endl;
+      return 1;
+    }
+  }
+  if (const char* env_p = std::getenv("BVH_LAYOUT")) {
+    if (!ParseBvhLayout(env_p, &bvh_options.layout)) {
+      std::cerr << "BVH layout " << env_p << " not found" << std::endl;
+      return 1;
+    }
+  }
+  if (const char* env_p = std::getenv("BVH_BINS")) {
+    bvh_options.bin_count = std::stoi(env_p);
+  }
+  if (const char* env_p = std::getenv("BVH_LEAF_SIZE")) {
+    bvh_options.max_leaf_size = std::stoi(env_p);
+  }
+  bvh_options.thread_count = thread_count;
+  if (const char* env_p = std::getenv("BVH_THREADS")) {
+    bvh_options.thread_count = std::stoi(env_p);
+  }
+  if (const char* env_p = std::getenv("BVH_REPORT")) {
+    bvh_options.report = std::stoi(env_p) != 0;
+  }
+  if (const char* env_p = std::getenv("BVH_CACHE")) {
+    bvh_options.cache_directory = env_p;
+  }
+  if (const char* env_p = std::getenv("STATS_FILE")) {
+    stats_file = env_p;
+  }
+
+  if (integrator != "path" && integrator != "wavefront") {
+    std::cerr << "Integrator " << integrator << " not found" << std::endl;
+    return 1;
+  }
+  if (packets && integrator != "wavefront") {
+    std::cerr << "PACKETS requires INTEGRATOR=wavefront" << std::endl;
+    return 1;
+  }
+  if (mesh_file.empty() && !scenes.Contains(scene_name)) {
+    std::cerr << "Scene " << scene_name << " not found, available scenes:";
+    for (const auto& name : scenes.Names()) {
+      std::cerr << ' ' << name;
+    }
+    std::cerr << std::endl;
     return 1;
   }
   std::cerr << "Rendering Scene:  " << scene_name << std::endl;
-  auto world = world_map[scene_name];
+  PhaseTimes times;
+  auto build_start = std::chrono::steady_clock::now();
+  auto world = mesh_file.empty() ? scenes.Build(scene_name, camera)
+                                  : MeshFile(camera, mesh_file);
+  if (world.objects_.empty()) {
+    std::cerr << "Scene " << scene_name << " is empty" << std::endl;
+    return 1;
+  }
+  times.scene_build = std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - build_start)
+                          .count();
+  std::cerr << "Built scene in " << times.scene_build << " seconds, "
+            << DefaultMaterialTable().Size() << " materials ("
+            << DefaultMaterialTable().MergedCount() << " duplicates merged)"
+            << std::endl;
 
   camera = world.camera_;
   aspect_ratio = camera->aspect_ratio_;
   int image_height = static_cast<int>(image_width / aspect_ratio);
 
-  // Output
-  std::ofstream ofs(scene_name + ".ppm");
+  RenderSettings settings{image_width, image_height, max_depth,
+                          samples_per_pixel};
+  settings.adaptive_threshold = adaptive_threshold;
+  settings.adaptive_min_samples = adaptive_min_samples;
+  settings.adaptive_max_samples = adaptive_max_samples > 0
+                                      ? adaptive_max_samples
+                                      : 4 * samples_per_pixel;
+  settings.wavefront = integrator == "wavefront";
+  settings.wavefront_batch_size = wavefront_batch_size;
+  settings.packets = packets;
 
   // Render
-  ofs << "P3\n" << image_width << ' ' << image_height << "\n255\n";
+  Image frame{image_width, image_height,
+              std::vector<Color>(image_width * image_height),
+              std::vector<int>(image_width * image_height)};
+
+  TileScheduler scheduler(image_width, image_height, tile_size, thread_count);
+  std::cerr << "Rendering " << scheduler.TileCount() << " tiles on "
+            << scheduler.ThreadCount() << " threads" << std::endl;
+  std::vector<TileScratch> scratch(scheduler.ThreadCount());
+  for (auto& thread_scratch : scratch) {
+    if (settings.wavefront) {
+      thread_scratch.wavefront = std::make_unique<WavefrontIntegrator>(
+          world, *world.camera_, settings);
+    }
+  }
 
-  auto* fb = new Color[image_width * image_height];
+  // Wall-clock time: clock() sums CPU time over every render thread.
+  auto start = std::chrono::steady_clock::now();
 
-  clock_t start, stop;
-  start = clock();
+  scheduler.Run([&](const Tile& tile, int thread_index) {
+    RenderTile(tile, settings, world, &scratch[thread_index],
+               frame.sums.data(), frame.sample_counts.data());
+  });
 
-  for (int j = image_height - 1; j >= 0; --j) {
-    std::cerr << "\rScanline's remaining:" << j << ' ' << std::flush;
-    for (int i = 0; i < image_width; ++i) {
-      Render(i, j, fb, image_width, image_height, world, max_depth,
-             samples_per_pixel);
-    }
-  }
+  auto stop = std::chrono::steady_clock::now();
+  times.render = std::chrono::duration<double>(stop - start).count();
+  std::cerr << std::endl << "Took " << times.render << " seconds.\n";
 
-  stop = clock();
-  double timer_seconds = ((double)(stop - start)) / CLOCKS_PER_SEC;
-  std::cerr << std::endl << "Took " << timer_seconds << " seconds.\n";
+  long total_samples = 0;
+  for (auto sample_count : frame.sample_counts) {
+    total_samples += sample_count;
+  }
+  std::cerr << "Average samples per pixel: "
+            << static_cast<double>(total_samples) /
+                   (image_width * image_height)
+            << std::endl;
 
-  for (int j = image_height - 1; j >= 0; --j) {
-    for (int i = 0; i < image_width; ++i) {
-      auto pixel_index = j * image_width + i;
-      write_color(ofs, fb[pixel_index], samples_per_pixel);
-    }
+  // Output
+  auto output_name = scene_name + ImageExtension(output_format);
+  std::cerr << "Writing " << output_name << std::endl;
+  auto output_start = std::chrono::steady_clock::now();
+  ImageWriter writer;
+  writer.Submit(output_name, output_format, std::move(frame));
+  // Tear down the scene and the render buffers while the image is encoded.
+  scratch.clear();
+  world.objects_.clear();
+  writer.Finish();
+  times.output = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - output_start)
+                     .count();
+
+#ifdef RT_ENABLE_STATS
+  if (stats_file.empty()) {
+    stats_file = scene_name + ".stats.json";
+  }
+  std::cerr << "Writing " << stats_file << std::endl;
+  std::ofstream stats_out(stats_file);
+  WriteStatsJson(stats_out, Stats::Collect(), times);
+#else
+  if (!stats_file.empty()) {
+    std::cerr << "STATS_FILE requires building with -DRT_STATS=ON"
+              << std::endl;
   }
+#endif
 
   std::cerr << "\nDone.\n";
 }
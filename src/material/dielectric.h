@@ -1,13 +1,14 @@
 #pragma once
 #include "material.h"
 
-class Dielectric : public Material {
+class Dielectric final : public Material {
  public:
   explicit Dielectric(float index_of_refraction)
-      : index_of_refraction_(index_of_refraction) {}
+      : Material(MaterialType::kDielectric),
+        index_of_refraction_(index_of_refraction) {}
 
   bool Scatter(const Ray& r_in, const HitRecord& hitRecord, Color* attenuation,
-               Ray* scattered) const override {
+               Ray* scattered, Sampler* sampler) const override {
     *attenuation = Color(1.0, 1.0, 1.0);
     double refraction_ratio = hitRecord.front_face
                                   ? (1.0 / index_of_refraction_)
@@ -21,16 +22,22 @@ class Dielectric : public Material {
     Vec3 direction;
 
     if (cannot_refract ||
-        reflectance(cos_theta, refraction_ratio) > RandomDouble()) {
+        reflectance(cos_theta, refraction_ratio) > sampler->Next()) {
       direction = Reflect(unit_direction, hitRecord.normal);
     } else {
       direction = Refract(unit_direction, hitRecord.normal, refraction_ratio);
     }
 
-    *scattered = Ray(hitRecord.p, direction, r_in.Time());
+    *scattered = Ray(hitRecord.p, direction, r_in.Time(), sampler);
     return true;
   }
 
+  [[nodiscard]] std::string Key() const override {
+    std::string key = "dielectric";
+    AppendToKey(&key, index_of_refraction_);
+    return key;
+  }
+
   float index_of_refraction_;
 
  private:
@@ -4,17 +4,25 @@
 #include "solid_color.h"
 #include "texture/texture.h"
 
-class DiffuseLight : public Material {
+class DiffuseLight final : public Material {
  public:
-  explicit DiffuseLight(std::shared_ptr<Texture> a) : emit_(std::move(a)) {}
-  explicit DiffuseLight(Color c) : emit_(std::make_shared<SolidColor>(c)) {}
+  explicit DiffuseLight(std::shared_ptr<Texture> a)
+      : Material(MaterialType::kDiffuseLight), emit_(std::move(a)) {}
+  explicit DiffuseLight(Color c)
+      : Material(MaterialType::kDiffuseLight),
+        emit_(std::make_shared<SolidColor>(c)) {}
 
   bool Scatter(const Ray& r_in, const HitRecord& rec, Color* attenuation,
-               Ray* scattered) const override {
+               Ray* scattered, Sampler* sampler) const override {
     return false;
   }
   Color Emitted(double u, double v, const Point3& p) const override {
-    return emit_->Value(u, v, p);
+    return TextureValue(*emit_, u, v, p);
+  }
+
+  [[nodiscard]] std::string Key() const override {
+    std::string key = "diffuse_light";
+    return AppendKeyToKey(&key, emit_->Key()) ? key : std::string();
   }
 
  private:
@@ -0,0 +1,90 @@
+#pragma once
+
+// First, for the HitRecord the materials use; it includes this file back
+// at its end.
+#include "object/hittable.h"
+
+#include "material/dielectric.h"
+#include "material/diffuse_light.h"
+#include "material/isotropic.h"
+#include "material/lambertian.h"
+#include "material/material.h"
+#include "material/metal.h"
+#include "material/solid_color.h"
+#include "material/texture/checker_texture.h"
+#include "material/texture/image_texture.h"
+#include "material/texture/noise_texture.h"
+
+// Static dispatch over the built-in materials and textures. When built with
+// -DRT_STATIC_DISPATCH=ON (which defines RT_ENABLE_STATIC_DISPATCH), these
+// switch on the type tag and call the final classes directly, so that the
+// compiler can inline them into the integrators; other types, and all types
+// otherwise, go through the vtable.
+
+Color TextureValue(const Texture& texture, double u, double v,
+                   const Point3& p) {
+#ifdef RT_ENABLE_STATIC_DISPATCH
+  switch (texture.Type()) {
+    case TextureType::kSolidColor:
+      return static_cast<const SolidColor&>(texture).Value(u, v, p);
+    case TextureType::kChecker:
+      return static_cast<const CheckTexture&>(texture).Value(u, v, p);
+    case TextureType::kNoise:
+      return static_cast<const NoiseTexture&>(texture).Value(u, v, p);
+    case TextureType::kImage:
+      return static_cast<const ImageTexture&>(texture).Value(u, v, p);
+    case TextureType::kOther:
+      break;
+  }
+#endif
+  return texture.Value(u, v, p);
+}
+
+// material.Scatter(r_in, rec, attenuation, scattered, sampler).
+bool MaterialScatter(const Material& material, const Ray& r_in,
+                     const HitRecord& rec, Color* attenuation, Ray* scattered,
+                     Sampler* sampler) {
+#ifdef RT_ENABLE_STATIC_DISPATCH
+  switch (material.Type()) {
+    case MaterialType::kLambertian:
+      return static_cast<const Lambertian&>(material).Scatter(
+          r_in, rec, attenuation, scattered, sampler);
+    case MaterialType::kMetal:
+      return static_cast<const Metal&>(material).Scatter(
+          r_in, rec, attenuation, scattered, sampler);
+    case MaterialType::kDielectric:
+      return static_cast<const Dielectric&>(material).Scatter(
+          r_in, rec, attenuation, scattered, sampler);
+    case MaterialType::kIsotropic:
+      return static_cast<const Isotropic&>(material).Scatter(
+          r_in, rec, attenuation, scattered, sampler);
+    case MaterialType::kDiffuseLight:
+      return false;
+    case MaterialType::kOther:
+      break;
+  }
+#endif
+  return material.Scatter(r_in, rec, attenuation, scattered, sampler);
+}
+
+// Adds the light `material` emits at the hit, times `weight`, to
+// `radiance`. With static dispatch only DiffuseLight and materials outside
+// the built-in set are asked; the other built-in materials emit nothing.
+void AddEmitted(const Material& material, const HitRecord& rec,
+                const Color& weight, Color* radiance) {
+#ifdef RT_ENABLE_STATIC_DISPATCH
+  switch (material.Type()) {
+    case MaterialType::kDiffuseLight:
+      *radiance += weight * static_cast<const DiffuseLight&>(material).Emitted(
+                                rec.u, rec.v, rec.p);
+      return;
+    case MaterialType::kOther:
+      break;
+    default:
+      return;
+  }
+#endif
+  *radiance += weight * material.Emitted(rec.u, rec.v, rec.p);
+}
+
+#pragma endregion  // RAY_TRACING_ONE_WEEK_DISPATCH_H
@@ -4,19 +4,27 @@
 #include "material.h"
 #include "solid_color.h"
 
-class Isotropic : public Material {
+class Isotropic final : public Material {
  public:
   explicit Isotropic(const Color& a)
-      : albedo_(std::make_shared<SolidColor>(a)) {}
-  explicit Isotropic(std::shared_ptr<Texture> a) : albedo_(std::move(a)) {}
+      : Material(MaterialType::kIsotropic),
+        albedo_(std::make_shared<SolidColor>(a)) {}
+  explicit Isotropic(std::shared_ptr<Texture> a)
+      : Material(MaterialType::kIsotropic), albedo_(std::move(a)) {}
 
   bool Scatter(const Ray& r_in, const HitRecord& rec, Color* attenuation,
-               Ray* scattered) const override {
-    *scattered = Ray(rec.p, RandomInUnitSphere(), r_in.Time());
-    *attenuation = albedo_->Value(rec.u, rec.v, rec.p);
+               Ray* scattered, Sampler* sampler) const override {
+    *scattered =
+        Ray(rec.p, RandomInUnitSphere(sampler), r_in.Time(), sampler);
+    *attenuation = TextureValue(*albedo_, rec.u, rec.v, rec.p);
     return true;
   }
 
+  [[nodiscard]] std::string Key() const override {
+    std::string key = "isotropic";
+    return AppendKeyToKey(&key, albedo_->Key()) ? key : std::string();
+  }
+
  private:
   std::shared_ptr<Texture> albedo_;
 };
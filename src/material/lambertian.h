@@ -4,25 +4,34 @@
 #include "material.h"
 #include "solid_color.h"
 
-class Lambertian : public Material {
+class Lambertian final : public Material {
  public:
-  explicit Lambertian(const Color& a) : albedo_(make_shared<SolidColor>(a)) {}
-  explicit Lambertian(std::shared_ptr<Texture> a) : albedo_(std::move(a)) {}
+  explicit Lambertian(const Color& a)
+      : Material(MaterialType::kLambertian),
+        albedo_(make_shared<SolidColor>(a)) {}
+  explicit Lambertian(std::shared_ptr<Texture> a)
+      : Material(MaterialType::kLambertian), albedo_(std::move(a)) {}
 
   bool Scatter(const Ray& r_in, const HitRecord& hit_record, Color* attenuation,
-               Ray* scattered) const override {
-    auto scatter_direction = hit_record.normal + RandomUnitVector();
+               Ray* scattered, Sampler* sampler) const override {
+    auto scatter_direction = hit_record.normal + RandomUnitVector(sampler);
 
     // Catch degenerate Scatter direction
     if (scatter_direction.NearZero()) {
       scatter_direction = hit_record.normal;
     }
 
-    *scattered = Ray(hit_record.p, scatter_direction, r_in.Time());
-    *attenuation = albedo_->Value(hit_record.u, hit_record.v, hit_record.p);
+    *scattered = Ray(hit_record.p, scatter_direction, r_in.Time(), sampler);
+    *attenuation =
+        TextureValue(*albedo_, hit_record.u, hit_record.v, hit_record.p);
     return true;
   }
 
+  [[nodiscard]] std::string Key() const override {
+    std::string key = "lambertian";
+    return AppendKeyToKey(&key, albedo_->Key()) ? key : std::string();
+  }
+
   std::shared_ptr<Texture> albedo_;
 };
 
@@ -1,17 +1,51 @@
 #pragma once
 
+#include <string>
+
+#include "material/texture/texture.h"
 #include "utility/rtweekend.h"
 
 struct HitRecord;
 
+// The built-in materials, used by the wavefront integrator to shade hits in
+// batches of one material kind at a time, and by static dispatch (see
+// material/dispatch.h) to call them without going through the vtable.
+enum class MaterialType {
+  kLambertian,
+  kMetal,
+  kDielectric,
+  kIsotropic,
+  kDiffuseLight,
+  kOther,
+};
+const int kMaterialTypeCount = 6;
+
 class Material {
  public:
+  Material() = default;
+  virtual ~Material() = default;
+
+  // kOther for materials outside the built-in set. The built-in materials
+  // are final, so that the tag always names the exact class.
+  [[nodiscard]] MaterialType Type() const { return type_; }
   [[nodiscard]] virtual Color Emitted(double u, double v,
                                       const Point3& p) const {
     return {0, 0, 0};
   }
   virtual bool Scatter(const Ray& r_in, const HitRecord& rec,
-                       Color* attenuation, Ray* scattered) const = 0;
+                       Color* attenuation, Ray* scattered,
+                       Sampler* sampler) const = 0;
+
+  // The material's kind and parameters, equal for materials that scatter
+  // and emit alike, or empty when it cannot tell (the default). The
+  // MaterialTable keeps one of the materials with the same key.
+  [[nodiscard]] virtual std::string Key() const { return {}; }
+
+ protected:
+  explicit Material(MaterialType type) : type_(type) {}
+
+ private:
+  MaterialType type_{MaterialType::kOther};
 };
 
 #pragma endregion
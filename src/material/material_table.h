@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "material/material.h"
+
+// Index of a material in a MaterialTable, which is all that primitives and
+// HitRecords keep of their material.
+using MaterialId = uint32_t;
+
+// Owns the materials of the scenes in a flat array, so that hits carry a
+// 32-bit id and resolve it without touching any reference count. Adding a
+// material with the same Key as one in the table returns the id of that
+// one instead. Filled while scenes are built and only read while rendering.
+class MaterialTable {
+ public:
+  MaterialId Add(std::shared_ptr<Material> material) {
+    auto key = material->Key();
+    if (!key.empty()) {
+      auto [it, inserted] =
+          ids_.emplace(std::move(key), static_cast<MaterialId>(Size()));
+      if (!inserted) {
+        ++merged_count_;
+        return it->second;
+      }
+    }
+    materials_.push_back(std::move(material));
+    return static_cast<MaterialId>(materials_.size() - 1);
+  }
+
+  [[nodiscard]] const Material& operator[](MaterialId id) const {
+    return *materials_[id];
+  }
+
+  [[nodiscard]] size_t Size() const { return materials_.size(); }
+  // How many added materials were duplicates of one in the table.
+  [[nodiscard]] long MergedCount() const { return merged_count_; }
+
+ private:
+  std::vector<std::shared_ptr<Material>> materials_;
+  std::unordered_map<std::string, MaterialId> ids_;
+  long merged_count_{};
+};
+
+// The table the primitives add their materials to.
+MaterialTable& DefaultMaterialTable() {
+  static MaterialTable table;
+  return table;
+}
+
+#pragma endregion  // RAY_TRACING_ONE_WEEK_MATERIAL_TABLE_H
@@ -1,19 +1,27 @@
 #pragma once
 #include "material.h"
 
-class Metal : public Material {
+class Metal final : public Material {
  public:
-  explicit Metal(const Color& a, double f) : albedo_(a), fuzz_(f) {}
+  explicit Metal(const Color& a, double f)
+      : Material(MaterialType::kMetal), albedo_(a), fuzz_(f) {}
 
   bool Scatter(const Ray& r_in, const HitRecord& rec, Color* attenuation,
-               Ray* scattered) const override {
+               Ray* scattered, Sampler* sampler) const override {
     Vec3 reflected = Reflect(UnitVector(r_in.Direction()), rec.normal);
-    *scattered =
-        Ray(rec.p, reflected + fuzz_ * RandomInUnitSphere(), r_in.Time());
+    *scattered = Ray(rec.p, reflected + fuzz_ * RandomInUnitSphere(sampler),
+                     r_in.Time(), sampler);
     *attenuation = albedo_;
     return (Dot(scattered->Direction(), rec.normal) > 0);
   }
 
+  [[nodiscard]] std::string Key() const override {
+    std::string key = "metal";
+    AppendToKey(&key, albedo_);
+    AppendToKey(&key, fuzz_);
+    return key;
+  }
+
   Color albedo_;
   double fuzz_;
 };
@@ -2,9 +2,10 @@
 
 #include "material/texture/texture.h"
 
-class SolidColor : public Texture {
+class SolidColor final : public Texture {
  public:
-  explicit SolidColor(Color c) : color_value_(c) {}
+  explicit SolidColor(Color c)
+      : Texture(TextureType::kSolidColor), color_value_(c) {}
   explicit SolidColor(double red, double green, double blue)
       : SolidColor(Color(red, green, blue)) {}
 
@@ -13,6 +14,12 @@ class SolidColor : public Texture {
     return color_value_;
   }
 
+  [[nodiscard]] std::string Key() const override {
+    std::string key = "solid_color";
+    AppendToKey(&key, color_value_);
+    return key;
+  }
+
  private:
   Color color_value_;
 };
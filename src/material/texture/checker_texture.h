@@ -2,24 +2,35 @@
 
 #include "material/solid_color.h"
 
-class CheckTexture : public Texture {
+class CheckTexture final : public Texture {
  public:
-  CheckTexture() = default;
+  CheckTexture() : Texture(TextureType::kChecker) {}
   CheckTexture(std::shared_ptr<Texture> t0, std::shared_ptr<Texture> t1)
-      : even_(t0), odd_(t1) {}
+      : Texture(TextureType::kChecker), even_(t0), odd_(t1) {}
   CheckTexture(Color c1, Color c2)
-      : even_(make_shared<SolidColor>(c1)), odd_(make_shared<SolidColor>(c2)) {}
+      : Texture(TextureType::kChecker),
+        even_(make_shared<SolidColor>(c1)),
+        odd_(make_shared<SolidColor>(c2)) {}
 
   [[nodiscard]] Color Value(double u, double v,
                             const Point3& p) const override {
     auto sines = sin(10 * p.X()) * sin(10 * p.Y()) * sin(10 * p.Z());
     if (sines < 0) {
-      return odd_->Value(u, v, p);
+      return TextureValue(*odd_, u, v, p);
     } else {
-      return even_->Value(u, v, p);
+      return TextureValue(*even_, u, v, p);
     }
   }
 
+  [[nodiscard]] std::string Key() const override {
+    std::string key = "checker";
+    if (!AppendKeyToKey(&key, odd_->Key()) ||
+        !AppendKeyToKey(&key, even_->Key())) {
+      return {};
+    }
+    return key;
+  }
+
  public:
   std::shared_ptr<Texture> odd_;
   std::shared_ptr<Texture> even_;
@@ -5,14 +5,19 @@
 #include "stb/stb_image.h"
 #include "utility/rtweekend.h"
 
-class ImageTexture : public Texture {
+class ImageTexture final : public Texture {
  public:
   const static int bytes_per_pixel = 3;
 
   ImageTexture()
-      : data_(nullptr), width_(0), height_(0), bytes_per_scanline_(0) {}
+      : Texture(TextureType::kImage),
+        data_(nullptr),
+        width_(0),
+        height_(0),
+        bytes_per_scanline_(0) {}
 
-  explicit ImageTexture(const char* filename) {
+  explicit ImageTexture(const char* filename)
+      : Texture(TextureType::kImage) {
     auto components_per_pixel = bytes_per_pixel;
 
     data_ = stbi_load(filename, &width_, &height_, &components_per_pixel,
@@ -26,7 +31,7 @@ class ImageTexture : public Texture {
     bytes_per_scanline_ = bytes_per_pixel * width_;
   }
 
-  ~ImageTexture() { delete data_; }
+  ~ImageTexture() override { delete data_; }
 
   [[nodiscard]] Color Value(double u, double v, const Vec3& p) const override {
     // If we have no texture data, then return solid cyan as a debugging aid.
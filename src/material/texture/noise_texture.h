@@ -3,10 +3,11 @@
 #include "texture.h"
 #include "utility/perlin.h"
 
-class NoiseTexture : public Texture {
+class NoiseTexture final : public Texture {
  public:
-  NoiseTexture() = default;
-  explicit NoiseTexture(double scale) : scale_(scale) {}
+  NoiseTexture() : Texture(TextureType::kNoise) {}
+  explicit NoiseTexture(double scale)
+      : Texture(TextureType::kNoise), scale_(scale) {}
 
   [[nodiscard]] Color Value(double u, double v,
                             const Point3& p) const override {
@@ -1,11 +1,62 @@
 #pragma once
 
+#include <string>
+
 #include "utility/rtweekend.h"
 
+// Appends the bytes of `value` to the Key of a texture or material.
+template <typename T>
+void AppendToKey(std::string* key, const T& value) {
+  key->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Appends a nested Key, prefixed by its length so that the keys of
+// different nestings never collide. Returns false for an empty key, which
+// makes the enclosing one empty too.
+inline bool AppendKeyToKey(std::string* key, const std::string& nested) {
+  if (nested.empty()) {
+    return false;
+  }
+  AppendToKey(key, nested.size());
+  key->append(nested);
+  return true;
+}
+
+// The built-in textures, for static dispatch (see material/dispatch.h).
+enum class TextureType {
+  kSolidColor,
+  kChecker,
+  kNoise,
+  kImage,
+  kOther,
+};
+
 class Texture {
  public:
+  Texture() = default;
+  virtual ~Texture() = default;
+
   [[nodiscard]] virtual Color Value(double u, double v,
                                     const Point3& p) const = 0;
+
+  // The texture's kind and parameters, equal for textures that return the
+  // same values everywhere, or empty when it cannot tell (the default).
+  [[nodiscard]] virtual std::string Key() const { return {}; }
+
+  // kOther for textures outside the built-in set. The built-in textures are
+  // final, so that the tag always names the exact class.
+  [[nodiscard]] TextureType Type() const { return type_; }
+
+ protected:
+  explicit Texture(TextureType type) : type_(type) {}
+
+ private:
+  TextureType type_{TextureType::kOther};
 };
 
+// texture.Value(u, v, p), called directly for the built-in textures when
+// built with static dispatch. Defined in material/dispatch.h.
+Color TextureValue(const Texture& texture, double u, double v,
+                   const Point3& p);
+
 #pragma endregion  // RAY_TRACING_ONE_WEEK_TEXTURE_H
@@ -8,10 +8,18 @@ class XyRectangle : public Hittable {
   XyRectangle() = default;
   XyRectangle(double x0, double x1, double y0, double y1, double k,
               std::shared_ptr<Material> mat)
-      : x0_(x0), x1_(x1), y0_(y0), y1_(y1), k_(k), material_(std::move(mat)) {}
-
-  [[nodiscard]] bool Hit(const Ray& r, double t_min, double t_max,
-                         HitRecord* rec) const override;
+      : x0_(x0),
+        x1_(x1),
+        y0_(y0),
+        y1_(y1),
+        k_(k),
+        material_(DefaultMaterialTable().Add(std::move(mat))) {}
+
+  [[nodiscard]] bool FindHit(const Ray& r, double t_min, double t_max,
+                             HitRecord* rec) const override;
+  void CompleteHit(const Ray& r, HitRecord* rec) const override;
+  [[nodiscard]] bool Occluded(const Ray& r, double t_min,
+                              double t_max) const override;
 
   [[nodiscard]] bool BoundingBox(double time0, double time1,
                                  Aabb* output_box) const override {
@@ -23,7 +31,7 @@ class XyRectangle : public Hittable {
   }
 
  private:
-  std::shared_ptr<Material> material_;
+  MaterialId material_{};
   double x0_{}, x1_{}, y0_{}, y1_{}, k_{};
 };
 
@@ -32,10 +40,18 @@ class XzRectangle : public Hittable {
   XzRectangle() = default;
   XzRectangle(double x0, double x1, double z0, double z1, double k,
               std::shared_ptr<Material> mat)
-      : x0_(x0), x1_(x1), z0_(z0), z1_(z1), k_(k), material_(std::move(mat)) {}
-
-  [[nodiscard]] bool Hit(const Ray& r, double t_min, double t_max,
-                         HitRecord* rec) const override;
+      : x0_(x0),
+        x1_(x1),
+        z0_(z0),
+        z1_(z1),
+        k_(k),
+        material_(DefaultMaterialTable().Add(std::move(mat))) {}
+
+  [[nodiscard]] bool FindHit(const Ray& r, double t_min, double t_max,
+                             HitRecord* rec) const override;
+  void CompleteHit(const Ray& r, HitRecord* rec) const override;
+  [[nodiscard]] bool Occluded(const Ray& r, double t_min,
+                              double t_max) const override;
 
   [[nodiscard]] bool BoundingBox(double time0, double time1,
                                  Aabb* output_box) const override {
@@ -47,7 +63,7 @@ class XzRectangle : public Hittable {
   }
 
  private:
-  std::shared_ptr<Material> material_;
+  MaterialId material_{};
   double x0_{}, x1_{}, z0_{}, z1_{}, k_{};
 };
 
@@ -56,10 +72,18 @@ class YzRectangle : public Hittable {
   YzRectangle() = default;
   YzRectangle(double y0, double y1, double z0, double z1, double k,
               std::shared_ptr<Material> mat)
-      : y0_(y0), y1_(y1), z0_(z0), z1_(z1), k_(k), material_(std::move(mat)) {}
-
-  [[nodiscard]] bool Hit(const Ray& r, double t_min, double t_max,
-                         HitRecord* rec) const override;
+      : y0_(y0),
+        y1_(y1),
+        z0_(z0),
+        z1_(z1),
+        k_(k),
+        material_(DefaultMaterialTable().Add(std::move(mat))) {}
+
+  [[nodiscard]] bool FindHit(const Ray& r, double t_min, double t_max,
+                             HitRecord* rec) const override;
+  void CompleteHit(const Ray& r, HitRecord* rec) const override;
+  [[nodiscard]] bool Occluded(const Ray& r, double t_min,
+                              double t_max) const override;
 
   [[nodiscard]] bool BoundingBox(double time0, double time1,
                                  Aabb* output_box) const override {
@@ -71,12 +95,14 @@ class YzRectangle : public Hittable {
   }
 
  private:
-  std::shared_ptr<Material> material_;
+  MaterialId material_{};
   double y0_{}, y1_{}, z0_{}, z1_{}, k_{};
 };
 
-bool XyRectangle::Hit(const Ray& r, double t_min, double t_max,
-                      HitRecord* hit_record) const {
+bool XyRectangle::FindHit(const Ray& r, double t_min, double t_max,
+                          HitRecord* rec) const {
+  RT_STATS_ADD(
+      primitive_tests[static_cast<int>(PrimitiveType::kXyRectangle)], 1);
   auto t = (k_ - r.Origin().Z()) / r.Direction().Z();
   if (t < t_min || t > t_max) {
     return false;
@@ -86,18 +112,40 @@ bool XyRectangle::Hit(const Ray& r, double t_min, double t_max,
   if (x < x0_ || x > x1_ || y < y0_ || y > y1_) {
     return false;
   }
-  hit_record->u = (x - x0_) / (x1_ - x0_);
-  hit_record->v = (y - y0_) / (y1_ - y0_);
-  hit_record->t = t;
-  auto outward_normal = Vec3(0, 0, 1);
-  hit_record->SetFaceNormal(r, outward_normal);
-  hit_record->material = material_;
-  hit_record->p = r.At(t);
+  rec->t = t;
+  rec->primitive = this;
   return true;
 }
 
-bool XzRectangle::Hit(const Ray& r, double t_min, double t_max,
-                      HitRecord* rec) const {
+void XyRectangle::CompleteHit(const Ray& r, HitRecord* rec) const {
+  RT_STATS_ADD(hits_completed, 1);
+  auto t = rec->t;
+  auto x = r.Origin().X() + t * r.Direction().X();
+  auto y = r.Origin().Y() + t * r.Direction().Y();
+  rec->u = (x - x0_) / (x1_ - x0_);
+  rec->v = (y - y0_) / (y1_ - y0_);
+  auto outward_normal = Vec3(0, 0, 1);
+  rec->SetFaceNormal(r, outward_normal);
+  rec->material = material_;
+  rec->p = r.At(t);
+}
+
+bool XyRectangle::Occluded(const Ray& r, double t_min, double t_max) const {
+  RT_STATS_ADD(
+      primitive_tests[static_cast<int>(PrimitiveType::kXyRectangle)], 1);
+  auto t = (k_ - r.Origin().Z()) / r.Direction().Z();
+  if (t < t_min || t > t_max) {
+    return false;
+  }
+  auto x = r.Origin().X() + t * r.Direction().X();
+  auto y = r.Origin().Y() + t * r.Direction().Y();
+  return x >= x0_ && x <= x1_ && y >= y0_ && y <= y1_;
+}
+
+bool XzRectangle::FindHit(const Ray& r, double t_min, double t_max,
+                          HitRecord* rec) const {
+  RT_STATS_ADD(
+      primitive_tests[static_cast<int>(PrimitiveType::kXzRectangle)], 1);
   auto t = (k_ - r.Origin().Y()) / r.Direction().Y();
   if (t < t_min || t > t_max) {
     return false;
@@ -107,18 +155,40 @@ bool XzRectangle::Hit(const Ray& r, double t_min, double t_max,
   if (x < x0_ || x > x1_ || z < z0_ || z > z1_) {
     return false;
   }
+  rec->t = t;
+  rec->primitive = this;
+  return true;
+}
+
+void XzRectangle::CompleteHit(const Ray& r, HitRecord* rec) const {
+  RT_STATS_ADD(hits_completed, 1);
+  auto t = rec->t;
+  auto x = r.Origin().X() + t * r.Direction().X();
+  auto z = r.Origin().Z() + t * r.Direction().Z();
   rec->u = (x - x0_) / (x1_ - x0_);
   rec->v = (z - z0_) / (z1_ - z0_);
-  rec->t = t;
   auto outward_normal = Vec3(0, 1, 0);
   rec->SetFaceNormal(r, outward_normal);
   rec->material = material_;
   rec->p = r.At(t);
-  return true;
 }
 
-bool YzRectangle::Hit(const Ray& r, double t_min, double t_max,
-                      HitRecord* rec) const {
+bool XzRectangle::Occluded(const Ray& r, double t_min, double t_max) const {
+  RT_STATS_ADD(
+      primitive_tests[static_cast<int>(PrimitiveType::kXzRectangle)], 1);
+  auto t = (k_ - r.Origin().Y()) / r.Direction().Y();
+  if (t < t_min || t > t_max) {
+    return false;
+  }
+  auto x = r.Origin().X() + t * r.Direction().X();
+  auto z = r.Origin().Z() + t * r.Direction().Z();
+  return x >= x0_ && x <= x1_ && z >= z0_ && z <= z1_;
+}
+
+bool YzRectangle::FindHit(const Ray& r, double t_min, double t_max,
+                          HitRecord* rec) const {
+  RT_STATS_ADD(
+      primitive_tests[static_cast<int>(PrimitiveType::kYzRectangle)], 1);
   auto t = (k_ - r.Origin().X()) / r.Direction().X();
   if (t < t_min || t > t_max) {
     return false;
@@ -128,14 +198,34 @@ bool YzRectangle::Hit(const Ray& r, double t_min, double t_max,
   if (y < y0_ || y > y1_ || z < z0_ || z > z1_) {
     return false;
   }
+  rec->t = t;
+  rec->primitive = this;
+  return true;
+}
+
+void YzRectangle::CompleteHit(const Ray& r, HitRecord* rec) const {
+  RT_STATS_ADD(hits_completed, 1);
+  auto t = rec->t;
+  auto y = r.Origin().Y() + t * r.Direction().Y();
+  auto z = r.Origin().Z() + t * r.Direction().Z();
   rec->u = (y - y0_) / (y1_ - y0_);
   rec->v = (z - z0_) / (z1_ - z0_);
-  rec->t = t;
   auto outward_normal = Vec3(1, 0, 0);
   rec->SetFaceNormal(r, outward_normal);
   rec->material = material_;
   rec->p = r.At(t);
-  return true;
+}
+
+bool YzRectangle::Occluded(const Ray& r, double t_min, double t_max) const {
+  RT_STATS_ADD(
+      primitive_tests[static_cast<int>(PrimitiveType::kYzRectangle)], 1);
+  auto t = (k_ - r.Origin().X()) / r.Direction().X();
+  if (t < t_min || t > t_max) {
+    return false;
+  }
+  auto y = r.Origin().Y() + t * r.Direction().Y();
+  auto z = r.Origin().Z() + t * r.Direction().Z();
+  return y >= y0_ && y <= y1_ && z >= z0_ && z <= z1_;
 }
 
 #pragma endregion
\ No newline at end of file
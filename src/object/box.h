@@ -1,48 +1,133 @@
 #pragma once
-#include "aa_rectangle.h"
-#include "hittable_list.h"
+
+#include <memory>
+#include <utility>
+
+#include "hittable.h"
 #include "utility/rtweekend.h"
 
+// An axis-aligned box, intersected with one slab test. Its faces are
+// numbered by axis, first the three at box_min_ and then the three at
+// box_max_, and map u and v like the rectangles of the same orientation.
 class Box : public Hittable {
  public:
   Box() = default;
-  Box(const Point3& p0, const Point3& p1, std::shared_ptr<Material> ptr);
+  Box(const Point3& p0, const Point3& p1, std::shared_ptr<Material> ptr)
+      : box_min_(p0),
+        box_max_(p1),
+        material_(DefaultMaterialTable().Add(std::move(ptr))) {}
 
-  [[nodiscard]] bool Hit(const Ray& r, double t_min, double t_max,
-                         HitRecord* rec) const override {
-    return box_.Hit(r, t_min, t_max, rec);
+  [[nodiscard]] bool FindHit(const Ray& r, double t_min, double t_max,
+                             HitRecord* rec) const override;
+  void CompleteHit(const Ray& r, HitRecord* rec) const override {
+    RT_STATS_ADD(hits_completed, 1);
+    SetHitRecord(r, rec->t, static_cast<int>(rec->part), rec);
   }
 
+  [[nodiscard]] bool Occluded(const Ray& r, double t_min,
+                              double t_max) const override;
+
   [[nodiscard]] bool BoundingBox(double time0, double time1,
                                  Aabb* output_box) const override {
     *output_box = Aabb(box_min_, box_max_);
     return true;
   }
 
- private:
+  // Finds where `r` enters and leaves the box, and the faces it crosses
+  // there. Returns false when it misses the box. The distances are divided
+  // by the direction, not multiplied by its inverse, so that they match
+  // the BVH's SIMD test of several boxes bit for bit.
+  bool Slabs(const Ray& r, double* t_near, int* near_face, double* t_far,
+             int* far_face) const;
+
+  // Fills `rec` for a hit of `r` at `t` on `face`, as found by FindHit or
+  // by the BVH's SIMD test of several boxes.
+  void SetHitRecord(const Ray& r, double t, int face, HitRecord* rec) const;
+
   Point3 box_min_;
   Point3 box_max_;
-  HittableList box_;
+  MaterialId material_{};
 };
 
-Box::Box(const Point3& p0, const Point3& p1, std::shared_ptr<Material> ptr) {
-  box_min_ = p0;
-  box_max_ = p1;
+bool Box::Slabs(const Ray& r, double* t_near, int* near_face, double* t_far,
+                int* far_face) const {
+  *t_near = -infinity;
+  *t_far = infinity;
+  for (int a = 0; a < 3; ++a) {
+    auto t0 = (box_min_[a] - r.Origin()[a]) / r.Direction()[a];
+    auto t1 = (box_max_[a] - r.Origin()[a]) / r.Direction()[a];
+    auto face0 = a;
+    auto face1 = a + 3;
+    if (t1 < t0) {
+      std::swap(t0, t1);
+      std::swap(face0, face1);
+    }
+    if (*t_near < t0) {
+      *t_near = t0;
+      *near_face = face0;
+    }
+    if (t1 < *t_far) {
+      *t_far = t1;
+      *far_face = face1;
+    }
+  }
+  return *t_near <= *t_far;
+}
 
-  box_.Add(std::make_shared<XyRectangle>(p0.X(), p1.X(), p0.Y(), p1.Y(), p1.Z(),
-                                         ptr));
-  box_.Add(std::make_shared<XyRectangle>(p0.X(), p1.X(), p0.Y(), p1.Y(), p0.Z(),
-                                         ptr));
+bool Box::FindHit(const Ray& r, double t_min, double t_max,
+                  HitRecord* rec) const {
+  RT_STATS_ADD(primitive_tests[static_cast<int>(PrimitiveType::kBox)], 1);
+  double t_near;
+  double t_far;
+  int near_face = 0;
+  int far_face = 0;
+  if (!Slabs(r, &t_near, &near_face, &t_far, &far_face)) {
+    return false;
+  }
+  // A ray starting inside the box hits the face it leaves through.
+  if (t_min <= t_near && t_near <= t_max) {
+    rec->t = t_near;
+    rec->part = near_face;
+  } else if (t_min <= t_far && t_far <= t_max) {
+    rec->t = t_far;
+    rec->part = far_face;
+  } else {
+    return false;
+  }
+  rec->primitive = this;
+  return true;
+}
 
-  box_.Add(std::make_shared<XzRectangle>(p0.X(), p1.X(), p0.Z(), p1.Z(), p1.Y(),
-                                         ptr));
-  box_.Add(std::make_shared<XzRectangle>(p0.X(), p1.X(), p0.Z(), p1.Z(), p0.Y(),
-                                         ptr));
+bool Box::Occluded(const Ray& r, double t_min, double t_max) const {
+  RT_STATS_ADD(primitive_tests[static_cast<int>(PrimitiveType::kBox)], 1);
+  double t_near;
+  double t_far;
+  int near_face = 0;
+  int far_face = 0;
+  if (!Slabs(r, &t_near, &near_face, &t_far, &far_face)) {
+    return false;
+  }
+  return (t_min <= t_near && t_near <= t_max) ||
+         (t_min <= t_far && t_far <= t_max);
+}
 
-  box_.Add(std::make_shared<YzRectangle>(p0.Y(), p1.Y(), p0.Z(), p1.Z(), p1.X(),
-                                         ptr));
-  box_.Add(std::make_shared<YzRectangle>(p0.Y(), p1.Y(), p0.Z(), p1.Z(), p0.X(),
-                                         ptr));
+void Box::SetHitRecord(const Ray& r, double t, int face,
+                       HitRecord* rec) const {
+  auto axis = face % 3;
+  // The two axes spanning the face, in the order of its rectangle's u and
+  // v: x and y for xy faces, x and z for xz faces, y and z for yz faces.
+  auto u_axis = axis == 0 ? 1 : 0;
+  auto v_axis = axis == 2 ? 1 : 2;
+  rec->t = t;
+  rec->p = r.At(t);
+  auto u_along = r.Origin()[u_axis] + t * r.Direction()[u_axis];
+  auto v_along = r.Origin()[v_axis] + t * r.Direction()[v_axis];
+  rec->u = (u_along - box_min_[u_axis]) / (box_max_[u_axis] - box_min_[u_axis]);
+  rec->v = (v_along - box_min_[v_axis]) / (box_max_[v_axis] - box_min_[v_axis]);
+  Vec3 outward_normal(0, 0, 0);
+  outward_normal[axis] = face < 3 ? -1 : 1;
+  rec->SetFaceNormal(r, outward_normal);
+  rec->material = material_;
 }
 
-#pragma endregion
+#pragma endregion  // RAY_TRACING_ONE_WEEK_BOX_H
@@ -4,23 +4,129 @@
 
 #pragma once
 #include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "hittable.h"
 #include "hittable_list.h"
+#include "utility/parallel.h"
 #include "utility/rtweekend.h"
 
+enum class BvhBuilder {
+  // Splits at the object-count median along a random axis.
+  kMedian,
+  // Picks the split with the lowest surface area heuristic cost among
+  // bin_count candidate planes per axis, placed on binned centroids.
+  kSah,
+};
+
+// How MakeBvh lays out SAH-built trees in memory.
+enum class BvhLayout {
+  // A tree of BvhNodes.
+  kTree,
+  // A LinearBvh: binary nodes in one array.
+  kLinear,
+  // A Bvh4 or Bvh8: nodes of 4 or 8 children tested with SIMD.
+  kBvh4,
+  kBvh8,
+};
+
+bool ParseBvhBuilder(const std::string& name, BvhBuilder* builder) {
+  if (name == "sah") {
+    *builder = BvhBuilder::kSah;
+  } else if (name == "median") {
+    *builder = BvhBuilder::kMedian;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool ParseBvhLayout(const std::string& name, BvhLayout* layout) {
+  if (name == "tree") {
+    *layout = BvhLayout::kTree;
+  } else if (name == "linear") {
+    *layout = BvhLayout::kLinear;
+  } else if (name == "bvh4") {
+    *layout = BvhLayout::kBvh4;
+  } else if (name == "bvh8") {
+    *layout = BvhLayout::kBvh8;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+struct BvhBuildOptions {
+  BvhBuilder builder{BvhBuilder::kSah};
+  int bin_count{16};
+  // Ranges of at most this many objects may become a leaf when that is
+  // cheaper than splitting them further.
+  int max_leaf_size{4};
+  // Cost of visiting a node, relative to intersection_cost for testing an
+  // object.
+  double traversal_cost{1.0};
+  double intersection_cost{1.0};
+  BvhLayout layout{BvhLayout::kBvh4};
+  // Threads for SAH builds. Ranges of at least parallel_min_objects objects
+  // are binned in parallel chunks and have their two halves built on
+  // separate threads, each with half of the threads.
+  int thread_count{1};
+  long parallel_min_objects{16384};
+  // Whether LinearBvh and WideBvh print their size and build time, and
+  // LinearBvh also its depth and SAH cost.
+  bool report{};
+  // Directory of cache files that MakeBvh loads wide BVHs from and saves
+  // them to (see bvh_cache.h); empty to always build.
+  std::string cache_directory;
+};
+
+// Options used by BVHs built without explicit ones, such as the scenes'.
+BvhBuildOptions& DefaultBvhBuildOptions() {
+  static BvhBuildOptions options;
+  return options;
+}
+
+// An object with its bounding box and the centroid of that box, computed
+// once before a SAH build.
+struct BvhBuildObject {
+  std::shared_ptr<Hittable> object;
+  Aabb box;
+  Point3 centroid;
+};
+
+std::vector<BvhBuildObject> MakeBvhBuildObjects(const HittableList& list,
+                                                double time0, double time1,
+                                                int thread_count = 1);
+
+// Partitions [start, end) at the cheapest SAH plane and returns where the
+// right half starts, or returns end when a leaf is cheaper than any split
+// and may_be_leaf is set. Large ranges are binned on up to thread_count
+// threads. Stores the axis of the plane in split_axis, if given.
+// BuildObject is a BvhBuildObject or any other type with the same box and
+// centroid members, such as TriangleMesh's triangles.
+template <typename BuildObject>
+long SahSplit(std::vector<BuildObject>& objects, long start, long end,
+              const BvhBuildOptions& options, bool may_be_leaf,
+              int thread_count = 1, int* split_axis = nullptr);
+
 class BvhNode : public Hittable {
  public:
   BvhNode() = default;
   BvhNode(HittableList& list, double time0, double time1)
-      : BvhNode(list.objects_, 0, static_cast<long>(list.objects_.size()),
-                time0, time1) {}
+      : BvhNode(list, time0, time1, DefaultBvhBuildOptions()) {}
+  BvhNode(HittableList& list, double time0, double time1,
+          const BvhBuildOptions& options);
   BvhNode(std::vector<std::shared_ptr<Hittable>>& src_objects, long start,
           long end, double time0, double time1);
 
-  bool Hit(const Ray& r, double t_min, double t_max,
-           HitRecord* hit_record) const override;
+  bool FindHit(const Ray& r, double t_min, double t_max,
+               HitRecord* hit_record) const override;
+  bool Occluded(const Ray& r, double t_min, double t_max) const override;
   bool BoundingBox(double time0, double time1, Aabb* output_box) const override;
+  void HitPacket(const RayPacket& packet, unsigned int active, double t_min,
+                 PacketHit* hit) const override;
 
   static bool BoxCompare(const std::shared_ptr<Hittable>& a,
                          const std::shared_ptr<Hittable>& b, int axis) {
@@ -48,27 +154,87 @@ class BvhNode : public Hittable {
   std::shared_ptr<Hittable> left_;
   std::shared_ptr<Hittable> right_;
   Aabb box_;
+
+ private:
+  void BuildMedian(std::vector<std::shared_ptr<Hittable>>& src_objects,
+                   long start, long end, double time0, double time1);
+  // Builds the subtrees of [start, mid) and [mid, end) on thread_count
+  // threads.
+  void BuildSah(std::vector<BvhBuildObject>& objects, long start, long mid,
+                long end, const BvhBuildOptions& options, int thread_count);
+  static std::shared_ptr<Hittable> BuildSahSubtree(
+      std::vector<BvhBuildObject>& objects, long start, long end,
+      const BvhBuildOptions& options, int thread_count);
 };
 
-bool BvhNode::Hit(const Ray& r, double t_min, double t_max,
-                  HitRecord* hit_record) const {
+bool BvhNode::FindHit(const Ray& r, double t_min, double t_max,
+                      HitRecord* hit_record) const {
+  RT_STATS_ADD(bvh_nodes_visited, 1);
   if (!box_.Hit(r, t_min, t_max)) {
     return false;
   }
 
-  auto hit_left = left_->Hit(r, t_min, t_max, hit_record);
+  auto hit_left = left_->FindHit(r, t_min, t_max, hit_record);
   auto hit_right =
-      right_->Hit(r, t_min, hit_left ? hit_record->t : t_max, hit_record);
+      right_->FindHit(r, t_min, hit_left ? hit_record->t : t_max, hit_record);
   return hit_left || hit_right;
 }
 
+bool BvhNode::Occluded(const Ray& r, double t_min, double t_max) const {
+  RT_STATS_ADD(bvh_nodes_visited, 1);
+  return box_.Hit(r, t_min, t_max) && (left_->Occluded(r, t_min, t_max) ||
+                                       right_->Occluded(r, t_min, t_max));
+}
+
+void BvhNode::HitPacket(const RayPacket& packet, unsigned int active,
+                        double t_min, PacketHit* hit) const {
+  // Only the lanes that enter this node's box descend, each still clipped to
+  // its own closest hit so far.
+  RT_STATS_ADD(bvh_nodes_visited, 1);
+  active = box_.HitPacket(packet, active, t_min, hit->t_max);
+  if (active == 0) {
+    return;
+  }
+
+  left_->HitPacket(packet, active, t_min, hit);
+  right_->HitPacket(packet, active, t_min, hit);
+}
+
 bool BvhNode::BoundingBox(double time0, double time1, Aabb* output_box) const {
   *output_box = box_;
   return true;
 }
 
+BvhNode::BvhNode(HittableList& list, double time0, double time1,
+                 const BvhBuildOptions& options) {
+  RT_STATS_TIME(bvh_build_seconds);
+  auto size = static_cast<long>(list.objects_.size());
+  if (options.builder == BvhBuilder::kMedian) {
+    BuildMedian(list.objects_, 0, size, time0, time1);
+    return;
+  }
+
+  auto threads = std::max(options.thread_count, 1);
+  auto objects = MakeBvhBuildObjects(list, time0, time1, threads);
+  // The root always splits, even when SAH would prefer a single leaf, since
+  // it has to be a BvhNode.
+  if (size == 1) {
+    left_ = right_ = objects[0].object;
+    box_ = objects[0].box;
+  } else {
+    BuildSah(objects, 0, SahSplit(objects, 0, size, options, false, threads),
+             size, options, threads);
+  }
+}
+
 BvhNode::BvhNode(std::vector<std::shared_ptr<Hittable>>& src_objects,
                  long start, long end, double time0, double time1) {
+  RT_STATS_TIME(bvh_build_seconds);
+  BuildMedian(src_objects, start, end, time0, time1);
+}
+
+void BvhNode::BuildMedian(std::vector<std::shared_ptr<Hittable>>& src_objects,
+                          long start, long end, double time0, double time1) {
   int axis = RandomInt(0, 2);
   auto comparator = (axis == 0)   ? BoxXCompare
                     : (axis == 1) ? BoxYCompare
@@ -102,4 +268,194 @@ BvhNode::BvhNode(std::vector<std::shared_ptr<Hittable>>& src_objects,
 
   box_ = Aabb::SurroundingBox(box_left, box_right);
 }
+
+void BvhNode::BuildSah(std::vector<BvhBuildObject>& objects, long start,
+                       long mid, long end, const BvhBuildOptions& options,
+                       int thread_count) {
+  // The halves are disjoint ranges of objects, so they can be built at the
+  // same time.
+  if (thread_count > 1 && end - start >= options.parallel_min_objects) {
+    std::thread right([&] {
+      right_ = BuildSahSubtree(objects, mid, end, options, thread_count / 2);
+    });
+    left_ = BuildSahSubtree(objects, start, mid, options,
+                            thread_count - thread_count / 2);
+    right.join();
+  } else {
+    left_ = BuildSahSubtree(objects, start, mid, options, 1);
+    right_ = BuildSahSubtree(objects, mid, end, options, 1);
+  }
+
+  box_ = objects[start].box;
+  for (long i = start + 1; i < end; ++i) {
+    box_ = Aabb::SurroundingBox(box_, objects[i].box);
+  }
+}
+
+std::shared_ptr<Hittable> BvhNode::BuildSahSubtree(
+    std::vector<BvhBuildObject>& objects, long start, long end,
+    const BvhBuildOptions& options, int thread_count) {
+  if (end - start == 1) {
+    return objects[start].object;
+  }
+  auto mid = SahSplit(objects, start, end, options, true, thread_count);
+  if (mid == end) {
+    auto leaf = std::make_shared<HittableList>();
+    for (long i = start; i < end; ++i) {
+      leaf->Add(objects[i].object);
+    }
+    return leaf;
+  }
+
+  auto node = std::make_shared<BvhNode>();
+  node->BuildSah(objects, start, mid, end, options, thread_count);
+  return node;
+}
+
+std::vector<BvhBuildObject> MakeBvhBuildObjects(const HittableList& list,
+                                                double time0, double time1,
+                                                int thread_count) {
+  auto size = static_cast<long>(list.objects_.size());
+  std::vector<BvhBuildObject> objects(size);
+  ParallelFor(0, size, thread_count, [&](int, long first, long last) {
+    for (long i = first; i < last; ++i) {
+      const auto& object = list.objects_[i];
+      Aabb box;
+      if (!object->BoundingBox(time0, time1, &box)) {
+        std::cerr << "No bounding box in BvhNode constructor.\n";
+      }
+      objects[i] = {object, box, 0.5 * (box.Minimum() + box.Maximum())};
+    }
+  });
+  return objects;
+}
+
+template <typename BuildObject>
+long SahSplit(std::vector<BuildObject>& objects, long start, long end,
+              const BvhBuildOptions& options, bool may_be_leaf,
+              int thread_count, int* split_axis) {
+  struct Bin {
+    Aabb box;
+    long count{};
+
+    void Add(const Aabb& other, long other_count) {
+      if (other_count == 0) {
+        return;
+      }
+      box = count == 0 ? other : Aabb::SurroundingBox(box, other);
+      count += other_count;
+    }
+  };
+  auto bin_count = std::max(options.bin_count, 2);
+  auto count = end - start;
+  thread_count = count < options.parallel_min_objects
+                     ? 1
+                     : static_cast<int>(std::min<long>(thread_count, count));
+
+  // Large ranges are reduced in chunks on thread_count threads. Merging
+  // boxes is exact, so the result does not depend on the chunking.
+  std::vector<Bin> chunk_bounds(thread_count);
+  std::vector<Aabb> chunk_centroids(thread_count);
+  ParallelFor(start, end, thread_count, [&](int chunk, long first, long last) {
+    auto centroids = Aabb(objects[first].centroid, objects[first].centroid);
+    for (long i = first; i < last; ++i) {
+      chunk_bounds[chunk].Add(objects[i].box, 1);
+      centroids = Aabb::SurroundingBox(
+          centroids, Aabb(objects[i].centroid, objects[i].centroid));
+    }
+    chunk_centroids[chunk] = centroids;
+  });
+  Bin bounds;
+  auto centroids = chunk_centroids[0];
+  for (int chunk = 0; chunk < thread_count; ++chunk) {
+    bounds.Add(chunk_bounds[chunk].box, chunk_bounds[chunk].count);
+    centroids = Aabb::SurroundingBox(centroids, chunk_centroids[chunk]);
+  }
+  auto centroid_min = centroids.Minimum();
+  auto centroid_max = centroids.Maximum();
+  auto bin_of = [&](const BuildObject& object, int axis) {
+    auto extent = centroid_max[axis] - centroid_min[axis];
+    auto offset = (object.centroid[axis] - centroid_min[axis]) / extent;
+    return std::min(static_cast<int>(offset * bin_count), bin_count - 1);
+  };
+
+  // bins[(chunk * 3 + axis) * bin_count + b], merged into chunk 0.
+  std::vector<Bin> bins(thread_count * 3 * bin_count);
+  ParallelFor(start, end, thread_count, [&](int chunk, long first, long last) {
+    for (int axis = 0; axis < 3; ++axis) {
+      if (centroid_max[axis] - centroid_min[axis] <= 0) {
+        continue;
+      }
+      auto* axis_bins = &bins[(chunk * 3 + axis) * bin_count];
+      for (long i = first; i < last; ++i) {
+        axis_bins[bin_of(objects[i], axis)].Add(objects[i].box, 1);
+      }
+    }
+  });
+  for (int chunk = 1; chunk < thread_count; ++chunk) {
+    for (int b = 0; b < 3 * bin_count; ++b) {
+      bins[b].Add(bins[chunk * 3 * bin_count + b].box,
+                  bins[chunk * 3 * bin_count + b].count);
+    }
+  }
+
+  // Sweeps the bins of every axis, keeping the plane with the lowest
+  // cost = traversal + (area_left * count_left + area_right * count_right)
+  //                    / area * intersection.
+  auto best_cost = infinity;
+  int best_axis = -1;
+  int best_plane = 0;
+  std::vector<double> right_costs(bin_count);
+  for (int axis = 0; axis < 3; ++axis) {
+    if (centroid_max[axis] - centroid_min[axis] <= 0) {
+      continue;
+    }
+    const auto* axis_bins = &bins[axis * bin_count];
+
+    // right_costs[plane] is area * count of bins [plane, bin_count).
+    Bin right;
+    for (int plane = bin_count - 1; plane > 0; --plane) {
+      right.Add(axis_bins[plane].box, axis_bins[plane].count);
+      right_costs[plane] =
+          right.count == 0 ? 0 : right.box.SurfaceArea() * right.count;
+    }
+    Bin left;
+    for (int plane = 1; plane < bin_count; ++plane) {
+      left.Add(axis_bins[plane - 1].box, axis_bins[plane - 1].count);
+      if (left.count == 0 || left.count == count) {
+        continue;
+      }
+      auto cost = left.box.SurfaceArea() * left.count + right_costs[plane];
+      if (cost < best_cost) {
+        best_cost = cost;
+        best_axis = axis;
+        best_plane = plane;
+      }
+    }
+  }
+
+  auto area = bounds.box.SurfaceArea();
+  if (split_axis != nullptr) {
+    *split_axis = std::max(best_axis, 0);
+  }
+  if (best_axis < 0) {
+    // Every centroid coincides: no plane separates them.
+    if (may_be_leaf && count <= options.max_leaf_size) {
+      return end;
+    }
+    return start + count / 2;
+  }
+  best_cost = options.traversal_cost +
+              (area > 0 ? best_cost / area : count) * options.intersection_cost;
+  if (may_be_leaf && count <= options.max_leaf_size &&
+      count * options.intersection_cost <= best_cost) {
+    return end;
+  }
+
+  auto mid = std::partition(objects.begin() + start, objects.begin() + end,
+                            [&](const BuildObject& object) {
+                              return bin_of(object, best_axis) < best_plane;
+                            });
+  return mid - objects.begin();
+}
 #pragma endregion  // RAY_TRACING_ONE_WEEK_BVH_H
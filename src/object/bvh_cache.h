@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "object/bvh.h"
+#include "object/hittable_list.h"
+#include "utility/aabb.h"
+
+// Built wide BVHs can be saved to cache files and mapped back by later runs
+// instead of being rebuilt. A file holds this header, then the nodes
+// exactly as they are laid out in memory, then for every primitive in leaf
+// order its index in the HittableList the BVH was built over. Offsets are
+// from the start of the file, so the nodes are used in place wherever the
+// file is mapped.
+//
+// Bump kBvhCacheVersion whenever the file layout, the node layout or the
+// builder's output changes, so that older files are rebuilt.
+constexpr uint32_t kBvhCacheVersion = 1;
+constexpr char kBvhCacheMagic[8] = {'R', 'T', 'B', 'V', 'H', 'C', 0, 0};
+
+struct BvhCacheHeader {
+  char magic[8];
+  uint32_t version;
+  // Node layout, which must match the reading build's: children per node,
+  // SIMD lanes per bounds array, whether the bounds have motion keyframes,
+  // and the node size.
+  uint32_t width;
+  uint32_t lanes;
+  uint32_t motion;
+  uint32_t node_size;
+  uint32_t reserved;
+  uint64_t key;
+  uint64_t node_count;
+  uint64_t primitive_count;
+  uint64_t nodes_offset;
+  uint64_t primitives_offset;
+  double box[2][3];
+  double time0;
+  double time_scale;
+};
+
+// Hashes 64-bit words with FNV-1a.
+class BvhCacheHasher {
+ public:
+  void Add(uint64_t word) { hash_ = (hash_ ^ word) * 0x100000001b3ull; }
+  void Add(double value) {
+    uint64_t word;
+    std::memcpy(&word, &value, sizeof(word));
+    Add(word);
+  }
+  void Add(const Aabb& box) {
+    for (int a = 0; a < 3; ++a) {
+      Add(box.Minimum()[a]);
+      Add(box.Maximum()[a]);
+    }
+  }
+  [[nodiscard]] uint64_t Value() const { return hash_; }
+
+ private:
+  uint64_t hash_{0xcbf29ce484222325ull};
+};
+
+// Key of the BVH over `list` built with `options` in a layout of `width`
+// children per node. A BVH depends only on its objects' boxes, so the key
+// hashes those (and their motion keyframes for motion BVHs) rather than the
+// objects themselves: changing a material reuses the cached tree, moving an
+// object rebuilds it.
+uint64_t BvhCacheKey(const HittableList& list, double time0, double time1,
+                     const BvhBuildOptions& options, int width, bool motion) {
+  BvhCacheHasher hasher;
+  hasher.Add(static_cast<uint64_t>(kBvhCacheVersion));
+  hasher.Add(static_cast<uint64_t>(width));
+  hasher.Add(static_cast<uint64_t>(motion));
+  hasher.Add(static_cast<uint64_t>(options.bin_count));
+  hasher.Add(static_cast<uint64_t>(options.max_leaf_size));
+  hasher.Add(options.traversal_cost);
+  hasher.Add(options.intersection_cost);
+  hasher.Add(time0);
+  hasher.Add(time1);
+  hasher.Add(static_cast<uint64_t>(list.objects_.size()));
+  for (const auto& object : list.objects_) {
+    Aabb box;
+    object->BoundingBox(time0, time1, &box);
+    hasher.Add(box);
+    if (motion) {
+      Aabb start_box;
+      Aabb end_box;
+      object->MotionBounds(time0, time1, &start_box, &end_box);
+      hasher.Add(start_box);
+      hasher.Add(end_box);
+    }
+  }
+  return hasher.Value();
+}
+
+// Path of the cache file for `key` in `directory`.
+std::string BvhCachePath(const std::string& directory, uint64_t key) {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.bvh",
+                static_cast<unsigned long long>(key));
+  return directory + "/" + name;
+}
+
+#pragma endregion  // RAY_TRACING_ONE_WEEK_BVH_CACHE_H
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <iostream>
+#include <memory>
+
+#include "object/bvh.h"
+#include "object/bvh_cache.h"
+#include "object/hittable.h"
+#include "object/hittable_list.h"
+#include "object/linear_bvh.h"
+#include "object/wide_bvh.h"
+
+// Whether any object's MotionBounds keyframes differ over [time0, time1].
+bool HasMotion(const HittableList& list, double time0, double time1) {
+  for (const auto& object : list.objects_) {
+    Aabb start_box;
+    Aabb end_box;
+    if (!object->MotionBounds(time0, time1, &start_box, &end_box)) {
+      continue;
+    }
+    for (int a = 0; a < 3; ++a) {
+      if (start_box.Minimum()[a] != end_box.Minimum()[a] ||
+          start_box.Maximum()[a] != end_box.Maximum()[a]) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Loads the WideBvh over `list` from options.cache_directory, or builds it
+// and saves it there for the next run.
+template <int kWidth, bool kMotion>
+std::shared_ptr<Hittable> MakeCachedWideBvh(HittableList& list, double time0,
+                                            double time1,
+                                            const BvhBuildOptions& options) {
+  using Bvh = WideBvh<kWidth, kMotion>;
+  if (options.cache_directory.empty()) {
+    return std::make_shared<Bvh>(list, time0, time1, options);
+  }
+  auto key = BvhCacheKey(list, time0, time1, options, kWidth, kMotion);
+  auto path = BvhCachePath(options.cache_directory, key);
+  if (auto bvh = Bvh::Load(path, key, list)) {
+    if (options.report) {
+      std::cerr << "BVH over " << list.objects_.size()
+                << " objects loaded from " << path << std::endl;
+    }
+    return bvh;
+  }
+  auto bvh = std::make_shared<Bvh>(list, time0, time1, options);
+  if (!bvh->Save(path, key, list)) {
+    std::cerr << "Could not write BVH cache file " << path << std::endl;
+  }
+  return bvh;
+}
+
+// Builds the BVH selected by the options: SAH trees in the chosen layout,
+// median trees always as BvhNodes. Wide layouts switch to a motion BVH when
+// objects move during [time0, time1]; the others bound moving objects by
+// their swept boxes. Only the wide layouts are cached.
+std::shared_ptr<Hittable> MakeBvh(HittableList& list, double time0,
+                                  double time1,
+                                  const BvhBuildOptions& options) {
+  if (options.builder == BvhBuilder::kSah) {
+    switch (options.layout) {
+      case BvhLayout::kTree:
+        break;
+      case BvhLayout::kLinear:
+        return std::make_shared<LinearBvh>(list, time0, time1, options);
+      case BvhLayout::kBvh4:
+        if (HasMotion(list, time0, time1)) {
+          return MakeCachedWideBvh<4, true>(list, time0, time1, options);
+        }
+        return MakeCachedWideBvh<4, false>(list, time0, time1, options);
+      case BvhLayout::kBvh8:
+        if (HasMotion(list, time0, time1)) {
+          return MakeCachedWideBvh<8, true>(list, time0, time1, options);
+        }
+        return MakeCachedWideBvh<8, false>(list, time0, time1, options);
+    }
+  }
+  return std::make_shared<BvhNode>(list, time0, time1, options);
+}
+
+std::shared_ptr<Hittable> MakeBvh(HittableList& list, double time0,
+                                  double time1) {
+  return MakeBvh(list, time0, time1, DefaultBvhBuildOptions());
+}
+
+#pragma endregion  // RAY_TRACING_ONE_WEEK_BVH_FACTORY_H
@@ -38,14 +38,14 @@ class Camera {
     time1_ = time1;
   }
 
-  [[nodiscard]] Ray GetRay(double s, double t) const {
-    Vec3 rd = lens_radius_ * RandomInUnitDisk();
+  [[nodiscard]] Ray GetRay(double s, double t, Sampler* sampler) const {
+    Vec3 rd = lens_radius_ * RandomInUnitDisk(sampler);
     Vec3 offset = u_ * rd.X() + v_ * rd.Y();
 
     return {
         origin_ + offset,
         lower_left_corner_ + s * horizontal_ + t * vertical_ - origin_ - offset,
-        RandomDouble(time0_, time1_)};
+        sampler->Next(time0_, time1_), sampler};
   }
 
  public:
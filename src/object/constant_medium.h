@@ -11,15 +11,27 @@ class ConstantMedium : public Hittable {
                  std::shared_ptr<Texture> a)
       : boundary(std::move(b)),
         neg_inv_density(-1 / d),
-        phase_function(std::make_shared<Isotropic>(a)) {}
+        phase_function(
+            DefaultMaterialTable().Add(std::make_shared<Isotropic>(a))) {}
 
   ConstantMedium(std::shared_ptr<Hittable> b, double d, Color c)
       : boundary(std::move(b)),
         neg_inv_density(-1 / d),
-        phase_function(std::make_shared<Isotropic>(c)) {}
+        phase_function(
+            DefaultMaterialTable().Add(std::make_shared<Isotropic>(c))) {}
 
   bool Hit(const Ray& r, double t_min, double t_max,
            HitRecord* rec) const override;
+  bool FindHit(const Ray& r, double t_min, double t_max,
+               HitRecord* rec) const override {
+    return FindCompletedHit(r, t_min, t_max, rec);
+  }
+  // Draws the same scattering distance as Hit would, so it consumes the
+  // same random numbers.
+  bool Occluded(const Ray& r, double t_min, double t_max) const override {
+    double t;
+    return SampleScatter(r, t_min, t_max, &t);
+  }
 
   bool BoundingBox(double time0, double time1,
                    Aabb* output_box) const override {
@@ -27,23 +39,37 @@ class ConstantMedium : public Hittable {
   }
 
  public:
+  // Samples where `r` scatters inside the boundary, within [t_min, t_max].
+  bool SampleScatter(const Ray& r, double t_min, double t_max,
+                     double* t) const;
+
   std::shared_ptr<Hittable> boundary;
-  std::shared_ptr<Material> phase_function;
+  MaterialId phase_function;
   double neg_inv_density;
 };
 
-bool ConstantMedium::Hit(const Ray& r, double t_min, double t_max,
-                         HitRecord* rec) const {
+bool ConstantMedium::SampleScatter(const Ray& r, double t_min, double t_max,
+                                   double* t) const {
+  RT_STATS_ADD(
+      primitive_tests[static_cast<int>(PrimitiveType::kConstantMedium)], 1);
   // Print occasional samples when debugging. To enable, set enableDebug true
   // and rebuild.
   constexpr bool enableDebug = false;
-  const bool debugging = enableDebug && RandomDouble() < 0.00001;
+  // Rays made without a sampler, such as the benchmarks', fall back to the
+  // global generator.
+  auto* sampler = r.GetSampler();
+  auto next = [sampler] {
+    return sampler != nullptr ? sampler->Next() : RandomDouble();
+  };
+  const bool debugging = enableDebug && next() < 0.00001;
 
   HitRecord rec1, rec2;
 
-  if (!boundary->Hit(r, -infinity, infinity, &rec1)) return false;
+  // Only the distances to the boundary are needed, so its hits are never
+  // completed.
+  if (!boundary->FindHit(r, -infinity, infinity, &rec1)) return false;
 
-  if (!boundary->Hit(r, rec1.t + 0.0001, infinity, &rec2)) return false;
+  if (!boundary->FindHit(r, rec1.t + 0.0001, infinity, &rec2)) return false;
 
   if (debugging)
     std::cerr << "\nt_min=" << rec1.t << ", t_max=" << rec2.t << '\n';
@@ -61,19 +87,26 @@ bool ConstantMedium::Hit(const Ray& r, double t_min, double t_max,
 
   const auto ray_length = r.direction_.Length();
   const auto distance_inside_boundary = (rec2.t - rec1.t) * ray_length;
-  const auto hit_distance = neg_inv_density * std::log(RandomDouble());
+  const auto hit_distance = neg_inv_density * std::log(next());
 
   if (hit_distance > distance_inside_boundary) return false;
 
-  rec->t = rec1.t + hit_distance / ray_length;
-  rec->p = r.At(rec->t);
+  *t = rec1.t + hit_distance / ray_length;
 
   if (debugging) {
     std::cerr << "hit_distance = " << hit_distance << '\n'
-              << "rec.t = " << rec->t << '\n'
-              << "rec.p = " << rec->p << '\n';
+              << "rec.t = " << *t << '\n'
+              << "rec.p = " << r.At(*t) << '\n';
   }
+  return true;
+}
 
+bool ConstantMedium::Hit(const Ray& r, double t_min, double t_max,
+                         HitRecord* rec) const {
+  if (!SampleScatter(r, t_min, t_max, &rec->t)) {
+    return false;
+  }
+  rec->p = r.At(rec->t);
   rec->normal = {1, 0, 0};  // arbitrary
   rec->front_face = true;   // also arbitrary
   rec->material = phase_function;
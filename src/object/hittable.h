@@ -1,19 +1,30 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
+#include <type_traits>
 
+#include "material/material_table.h"
 #include "utility/aabb.h"
+#include "utility/ray_packet.h"
 #include "utility/rtweekend.h"
+#include "utility/stats.h"
 
-class Material;
+class Hittable;
 
 struct HitRecord {
   Point3 p;
   Vec3 normal;
-  std::shared_ptr<Material> material;
   double t;
   double u;
   double v;
+  // In DefaultMaterialTable().
+  MaterialId material;
+  // Which part of `primitive` was hit, such as a box face or a triangle of
+  // a mesh, for its CompleteHit.
+  uint32_t part;
+  // The primitive FindHit found, whose CompleteHit fills the rest.
+  const Hittable* primitive;
   bool front_face;
 
   void SetFaceNormal(const Ray& ray, const Vec3& outward_normal) {
@@ -21,18 +32,110 @@ struct HitRecord {
     normal = front_face ? outward_normal : -outward_normal;
   }
 };
+static_assert(std::is_trivially_copyable_v<HitRecord>);
+
+// Closest hits found so far for the lanes of a RayPacket, recorded as
+// FindHit does, for the CompleteHit of their primitive to finish. t_max
+// starts as the far end of every lane's interval and shrinks as closer hits
+// are found.
+struct PacketHit {
+  alignas(64) double t_max[kPacketSize];
+  HitRecord records[kPacketSize];
+  unsigned int mask{};
+};
 
 class Hittable {
  public:
+  // The closest hit of `r` within [t_min, t_max], with the whole record
+  // filled. The default runs FindHit and then the CompleteHit of the
+  // primitive it found.
   virtual bool Hit(const Ray& r, double t_min, double t_max,
-                   HitRecord* rec) const = 0;
+                   HitRecord* rec) const;
+
+  // Like Hit, but primitives fill only t, primitive and part, and whatever
+  // else their CompleteHit reads, leaving the point, normal, UV and
+  // material until the closest hit is known. Aggregates call this on their
+  // children, so that only the hit they return pays for those. Hittables
+  // that fill the whole record in Hit instead, such as the transforms,
+  // implement this with FindCompletedHit.
+  virtual bool FindHit(const Ray& r, double t_min, double t_max,
+                       HitRecord* rec) const = 0;
+
+  // Fills the rest of `rec`, found on this primitive by FindHit for the
+  // same `r`.
+  virtual void CompleteHit(const Ray& r, HitRecord* rec) const {}
+
   virtual bool BoundingBox(double time0, double time1,
                            Aabb* output_box) const = 0;
+
+  // Whether anything intersects `r` within [t_min, t_max], for shadow and
+  // visibility rays. Unlike Hit it may stop at the first intersection it
+  // finds, in any order, and it fills no HitRecord. The default runs Hit.
+  virtual bool Occluded(const Ray& r, double t_min, double t_max) const;
+
+  // Intersects the lanes of `packet` selected by `active`, keeping for every
+  // lane the closest hit in [t_min, hit->t_max[lane]] exactly as FindHit
+  // would.
+  // Hittables with a SIMD kernel override this; the default traces each lane
+  // on its own.
+  virtual void HitPacket(const RayPacket& packet, unsigned int active,
+                         double t_min, PacketHit* hit) const;
+
+  // Boxes at time0 and time1 such that, at any time, interpolating between
+  // them linearly bounds the object. Motion BVHs store these keyframes
+  // instead of the box swept over the whole interval. Hittables that move
+  // linearly override this; the default returns the swept box twice.
+  virtual bool MotionBounds(double time0, double time1, Aabb* start_box,
+                            Aabb* end_box) const;
+
+ protected:
+  // FindHit for hittables whose Hit fills the whole record, leaving nothing
+  // for CompleteHit.
+  bool FindCompletedHit(const Ray& r, double t_min, double t_max,
+                        HitRecord* rec) const {
+    if (!Hit(r, t_min, t_max, rec)) {
+      return false;
+    }
+    rec->primitive = this;
+    return true;
+  }
 };
 
-#include "material/dielectric.h"
-#include "material/isotropic.h"
-#include "material/lambertian.h"
-#include "material/metal.h"
+bool Hittable::Hit(const Ray& r, double t_min, double t_max,
+                   HitRecord* rec) const {
+  if (!FindHit(r, t_min, t_max, rec)) {
+    return false;
+  }
+  rec->primitive->CompleteHit(r, rec);
+  return true;
+}
+
+void Hittable::HitPacket(const RayPacket& packet, unsigned int active,
+                         double t_min, PacketHit* hit) const {
+  for (int lane = 0; lane < packet.size; ++lane) {
+    if (((active >> lane) & 1) != 0 &&
+        FindHit(packet.rays[lane], t_min, hit->t_max[lane],
+                &hit->records[lane])) {
+      hit->t_max[lane] = hit->records[lane].t;
+      hit->mask |= 1u << lane;
+    }
+  }
+}
+
+bool Hittable::Occluded(const Ray& r, double t_min, double t_max) const {
+  HitRecord record;
+  return Hit(r, t_min, t_max, &record);
+}
+
+bool Hittable::MotionBounds(double time0, double time1, Aabb* start_box,
+                            Aabb* end_box) const {
+  if (!BoundingBox(time0, time1, start_box)) {
+    return false;
+  }
+  *end_box = *start_box;
+  return true;
+}
+
+#include "material/dispatch.h"
 
 #pragma endregion
@@ -14,20 +14,23 @@ class HittableList : public Hittable {
   HittableList() = default;
   explicit HittableList(const shared_ptr<Hittable>& object) { Add(object); }
   void Add(const shared_ptr<Hittable>& object) { objects_.push_back(object); }
-  bool Hit(const Ray& r, double t_min, double t_max,
-           HitRecord* hit_record) const override;
+  bool FindHit(const Ray& r, double t_min, double t_max,
+               HitRecord* hit_record) const override;
   bool BoundingBox(double time0, double time1, Aabb* output_box) const override;
+  bool Occluded(const Ray& r, double t_min, double t_max) const override;
+  void HitPacket(const RayPacket& packet, unsigned int active, double t_min,
+                 PacketHit* hit) const override;
   std::vector<shared_ptr<Hittable>> objects_;
   shared_ptr<Camera> camera_;
 };
 
-bool HittableList::Hit(const Ray& r, double t_min, double t_max,
-                       HitRecord* hit_record) const {
+bool HittableList::FindHit(const Ray& r, double t_min, double t_max,
+                           HitRecord* hit_record) const {
   HitRecord temp_record;
   bool hit_anything = false;
   double closest_so_far = t_max;
   for (const auto& object : objects_) {
-    if (object->Hit(r, t_min, closest_so_far, &temp_record)) {
+    if (object->FindHit(r, t_min, closest_so_far, &temp_record)) {
       hit_anything = true;
       closest_so_far = temp_record.t;
       *hit_record = temp_record;
@@ -36,6 +39,22 @@ bool HittableList::Hit(const Ray& r, double t_min, double t_max,
   return hit_anything;
 }
 
+bool HittableList::Occluded(const Ray& r, double t_min, double t_max) const {
+  for (const auto& object : objects_) {
+    if (object->Occluded(r, t_min, t_max)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void HittableList::HitPacket(const RayPacket& packet, unsigned int active,
+                             double t_min, PacketHit* hit) const {
+  for (const auto& object : objects_) {
+    object->HitPacket(packet, active, t_min, hit);
+  }
+}
+
 bool HittableList::BoundingBox(double time0, double time1,
                                Aabb* output_box) const {
   if (objects_.empty()) {
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <memory>
+#include <utility>
+
+#include "object/hittable.h"
+#include "utility/transform.h"
+
+// A placement of shared geometry in the world. The geometry, typically a
+// BVH built once in its own object space, is referenced rather than copied,
+// so many instances of it cost one object each; a BVH over the instances
+// then forms the top level of a two-level acceleration structure.
+//
+// Rays are moved into object space with the precomputed inverse and keep
+// their parameterization, so hit distances need no conversion; the hit point
+// and normal are moved back to the world.
+class Instance : public Hittable {
+ public:
+  Instance(std::shared_ptr<Hittable> geometry,
+           const Transform& object_to_world);
+
+  bool Hit(const Ray& r, double t_min, double t_max,
+           HitRecord* rec) const override;
+  bool FindHit(const Ray& r, double t_min, double t_max,
+               HitRecord* rec) const override {
+    return FindCompletedHit(r, t_min, t_max, rec);
+  }
+  [[nodiscard]] const std::shared_ptr<Hittable>& Geometry() const {
+    return geometry_;
+  }
+
+  bool Occluded(const Ray& r, double t_min, double t_max) const override {
+    return geometry_->Occluded(ToObject(r), t_min, t_max);
+  }
+  bool BoundingBox(double time0, double time1,
+                   Aabb* output_box) const override;
+  bool MotionBounds(double time0, double time1, Aabb* start_box,
+                    Aabb* end_box) const override;
+
+ private:
+  // `r` in object space, with the same parameterization.
+  [[nodiscard]] Ray ToObject(const Ray& r) const {
+    return {object_to_world_.InverseApplyToPoint(r.Origin()),
+            object_to_world_.InverseApplyToVector(r.Direction()), r.Time(),
+            r.GetSampler()};
+  }
+
+  std::shared_ptr<Hittable> geometry_;
+  Transform object_to_world_;
+};
+
+Instance::Instance(std::shared_ptr<Hittable> geometry,
+                   const Transform& object_to_world)
+    : geometry_(std::move(geometry)), object_to_world_(object_to_world) {}
+
+bool Instance::BoundingBox(double time0, double time1,
+                           Aabb* output_box) const {
+  if (!geometry_->BoundingBox(time0, time1, output_box)) {
+    return false;
+  }
+  *output_box = object_to_world_.ApplyToBox(*output_box);
+  return true;
+}
+
+bool Instance::MotionBounds(double time0, double time1, Aabb* start_box,
+                            Aabb* end_box) const {
+  if (!geometry_->MotionBounds(time0, time1, start_box, end_box)) {
+    return false;
+  }
+  // Each bound of a transformed box is linear in the bounds of the box, so
+  // the transformed keyframes still interpolate to bounds of the geometry.
+  *start_box = object_to_world_.ApplyToBox(*start_box);
+  *end_box = object_to_world_.ApplyToBox(*end_box);
+  return true;
+}
+
+bool Instance::Hit(const Ray& r, double t_min, double t_max,
+                   HitRecord* rec) const {
+  if (!geometry_->Hit(ToObject(r), t_min, t_max, rec)) {
+    return false;
+  }
+
+  // The recorded normal faces the object-space ray; SetFaceNormal orients
+  // the world normal against the world ray again.
+  rec->p = r.At(rec->t);
+  auto normal = UnitVector(object_to_world_.ApplyToNormal(rec->normal));
+  rec->SetFaceNormal(r, rec->front_face ? normal : -normal);
+  return true;
+}
+
+#pragma endregion  // RAY_TRACING_ONE_WEEK_INSTANCE_H
@@ -0,0 +1,340 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "object/bvh.h"
+#include "object/hittable.h"
+#include "object/hittable_list.h"
+#include "utility/rtweekend.h"
+#include "utility/stats.h"
+
+// A node of a LinearBvh. Bounds are stored as floats rounded outwards, so a
+// node is 32 bytes and two of them share a cache line; the rounding only
+// makes boxes slightly larger and never loses a hit.
+struct alignas(32) LinearBvhNode {
+  float bounds[2][3];
+  // Leaf: index of the first primitive. Interior: index of the second
+  // child; the first child is the next node in the array.
+  int32_t offset;
+  // Zero for interior nodes.
+  uint16_t primitive_count;
+  // Axis of the interior node's split plane.
+  uint8_t axis;
+};
+static_assert(sizeof(LinearBvhNode) == 32);
+
+// A SAH-built BVH flattened into a contiguous array of nodes in depth-first
+// order, with the primitives of each leaf stored next to each other.
+// Traversal keeps a small stack of node indices instead of recursing through
+// virtual calls, visits the child on the near side of the split plane first
+// and skips the far child as soon as a hit closer than its box is known.
+class LinearBvh : public Hittable {
+ public:
+  LinearBvh(HittableList& list, double time0, double time1)
+      : LinearBvh(list, time0, time1, DefaultBvhBuildOptions()) {}
+  LinearBvh(HittableList& list, double time0, double time1,
+            const BvhBuildOptions& options);
+
+  bool FindHit(const Ray& r, double t_min, double t_max,
+               HitRecord* hit_record) const override;
+  bool Occluded(const Ray& r, double t_min, double t_max) const override;
+  bool BoundingBox(double time0, double time1, Aabb* output_box) const override;
+
+  [[nodiscard]] const std::vector<LinearBvhNode>& Nodes() const {
+    return nodes_;
+  }
+  // Primitives in leaf order.
+  [[nodiscard]] const std::vector<std::shared_ptr<Hittable>>& Objects() const {
+    return objects_;
+  }
+
+  // Shape of the tree, for comparing builders.
+  struct Quality {
+    long nodes{};
+    long leaves{};
+    int max_depth{};
+    double average_leaf_size{};
+    // Expected cost of tracing a ray through the tree under the surface area
+    // heuristic, with the build's traversal and intersection costs.
+    double sah_cost{};
+  };
+  [[nodiscard]] Quality ComputeQuality(const BvhBuildOptions& options) const;
+
+  // Deeper ranges become a single leaf, which bounds the traversal stack.
+  static constexpr int kMaxDepth = 64;
+  // Most primitives a leaf's primitive_count holds. Larger ranges are
+  // halved even where SAH or the depth limit would make them a leaf, which
+  // for fewer than 2^31 primitives adds at most kMaxLeafSplits levels.
+  static constexpr long kMaxLeafSize = UINT16_MAX;
+  static constexpr int kMaxLeafSplits = 16;
+
+  // Appends the subtree of [start, end) to `nodes` in depth-first order,
+  // building its halves on separate threads while thread_count allows.
+  // Leaves point into `objects`, whose order the build leaves final.
+  // BuildObject is as for SahSplit, so primitives other than Hittables,
+  // such as TriangleMesh's triangles, can share the layout.
+  template <typename BuildObject>
+  static void Build(std::vector<BuildObject>& objects, long start, long end,
+                    int depth, const BvhBuildOptions& options,
+                    int thread_count, std::vector<LinearBvhNode>* nodes);
+
+  // The traversal of `nodes` shared with TriangleMesh. Calls
+  // visit_leaf(first, count) with the range of primitives of every leaf
+  // whose box `r` enters within [t_min, *t_max]; visit_leaf may lower
+  // *t_max to skip the boxes beyond a hit, and returns true to stop the
+  // traversal. With kNearestFirst, the child on the near side of the split
+  // plane is visited first. Returns whether visit_leaf stopped it.
+  template <bool kNearestFirst, typename VisitLeaf>
+  static bool Traverse(const std::vector<LinearBvhNode>& nodes, const Ray& r,
+                       double t_min, const double* t_max,
+                       VisitLeaf&& visit_leaf);
+
+ private:
+  std::vector<LinearBvhNode> nodes_;
+  // Raw pointers in leaf order for traversal; objects_ owns them.
+  std::vector<const Hittable*> primitives_;
+  std::vector<std::shared_ptr<Hittable>> objects_;
+  Aabb box_;
+};
+
+LinearBvh::LinearBvh(HittableList& list, double time0, double time1,
+                     const BvhBuildOptions& options) {
+  RT_STATS_TIME(bvh_build_seconds);
+  auto start = std::chrono::steady_clock::now();
+  auto threads = std::max(options.thread_count, 1);
+  auto objects = MakeBvhBuildObjects(list, time0, time1, threads);
+  if (objects.empty()) {
+    return;
+  }
+  nodes_.reserve(2 * objects.size());
+  Build(objects, 0, static_cast<long>(objects.size()), 0, options, threads,
+        &nodes_);
+
+  box_ = objects[0].box;
+  for (const auto& object : objects) {
+    box_ = Aabb::SurroundingBox(box_, object.box);
+    primitives_.push_back(object.object.get());
+    objects_.push_back(object.object);
+  }
+
+  if (options.report) {
+    auto seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+    auto quality = ComputeQuality(options);
+    std::cerr << "BVH over " << objects.size() << " objects built in "
+              << seconds << " seconds on " << threads << " threads: "
+              << quality.nodes << " nodes, " << quality.leaves
+              << " leaves of " << quality.average_leaf_size
+              << " objects on average, depth " << quality.max_depth
+              << ", SAH cost " << quality.sah_cost << std::endl;
+  }
+}
+
+template <typename BuildObject>
+void LinearBvh::Build(std::vector<BuildObject>& objects, long start, long end,
+                      int depth, const BvhBuildOptions& options,
+                      int thread_count, std::vector<LinearBvhNode>* nodes) {
+  auto index = nodes->size();
+  nodes->emplace_back();
+  auto& node = nodes->back();
+
+  auto box = objects[start].box;
+  for (long i = start + 1; i < end; ++i) {
+    box = Aabb::SurroundingBox(box, objects[i].box);
+  }
+  for (int a = 0; a < 3; ++a) {
+    auto lo = static_cast<float>(box.Minimum()[a]);
+    auto hi = static_cast<float>(box.Maximum()[a]);
+    node.bounds[0][a] =
+        lo > box.Minimum()[a] ? std::nextafter(lo, -INFINITY) : lo;
+    node.bounds[1][a] =
+        hi < box.Maximum()[a] ? std::nextafter(hi, INFINITY) : hi;
+  }
+
+  int axis = 0;
+  auto mid = end;
+  if (end - start > 1 && depth < kMaxDepth) {
+    mid = SahSplit(objects, start, end, options, true, thread_count, &axis);
+  }
+  if (mid == end && end - start > kMaxLeafSize) {
+    mid = start + (end - start) / 2;
+  }
+  if (mid == end) {
+    // Leaves cover consecutive ranges of the final object order.
+    node.offset = static_cast<int32_t>(start);
+    node.primitive_count = static_cast<uint16_t>(end - start);
+    return;
+  }
+  node.axis = static_cast<uint8_t>(axis);
+
+  if (thread_count > 1 && end - start >= options.parallel_min_objects) {
+    // The halves are disjoint ranges of objects: build the second one into
+    // its own array on another thread, then append it, moving its child
+    // offsets past the nodes of the first half.
+    std::vector<LinearBvhNode> right_nodes;
+    std::thread right([&] {
+      Build(objects, mid, end, depth + 1, options, thread_count / 2,
+            &right_nodes);
+    });
+    Build(objects, start, mid, depth + 1, options,
+          thread_count - thread_count / 2, nodes);
+    right.join();
+
+    auto base = static_cast<int32_t>(nodes->size());
+    (*nodes)[index].offset = base;
+    for (auto right_node : right_nodes) {
+      if (right_node.primitive_count == 0) {
+        right_node.offset += base;
+      }
+      nodes->push_back(right_node);
+    }
+    return;
+  }
+
+  Build(objects, start, mid, depth + 1, options, 1, nodes);
+  (*nodes)[index].offset = static_cast<int32_t>(nodes->size());
+  Build(objects, mid, end, depth + 1, options, 1, nodes);
+}
+
+LinearBvh::Quality LinearBvh::ComputeQuality(
+    const BvhBuildOptions& options) const {
+  Quality quality;
+  if (nodes_.empty()) {
+    return quality;
+  }
+  auto area = [this](int index) {
+    const auto& bounds = nodes_[index].bounds;
+    return Aabb(Point3(bounds[0][0], bounds[0][1], bounds[0][2]),
+                Point3(bounds[1][0], bounds[1][1], bounds[1][2]))
+        .SurfaceArea();
+  };
+  auto root_area = area(0);
+
+  std::vector<std::pair<int, int>> stack = {{0, 1}};
+  while (!stack.empty()) {
+    auto [index, depth] = stack.back();
+    stack.pop_back();
+    const auto& node = nodes_[index];
+    auto weight = root_area > 0 ? area(index) / root_area : 1;
+    ++quality.nodes;
+    quality.max_depth = std::max(quality.max_depth, depth);
+    if (node.primitive_count > 0) {
+      ++quality.leaves;
+      quality.average_leaf_size += node.primitive_count;
+      quality.sah_cost +=
+          weight * node.primitive_count * options.intersection_cost;
+    } else {
+      quality.sah_cost += weight * options.traversal_cost;
+      stack.emplace_back(index + 1, depth + 1);
+      stack.emplace_back(node.offset, depth + 1);
+    }
+  }
+  quality.average_leaf_size /= static_cast<double>(quality.leaves);
+  return quality;
+}
+
+template <bool kNearestFirst, typename VisitLeaf>
+bool LinearBvh::Traverse(const std::vector<LinearBvhNode>& nodes,
+                         const Ray& r, double t_min, const double* t_max,
+                         VisitLeaf&& visit_leaf) {
+  if (nodes.empty()) {
+    return false;
+  }
+
+  const auto& origin = r.Origin();
+  const auto& direction = r.Direction();
+  double inv_direction[3];
+  int direction_is_negative[3];
+  for (int a = 0; a < 3; ++a) {
+    inv_direction[a] = 1.0 / direction[a];
+    direction_is_negative[a] = inv_direction[a] < 0;
+  }
+
+  int stack[kMaxDepth + kMaxLeafSplits + 1];
+  int stack_size = 0;
+  int current = 0;
+  while (true) {
+    const auto& node = nodes[current];
+    RT_STATS_ADD(bvh_nodes_visited, 1);
+    RT_STATS_ADD(aabb_tests, 1);
+
+    // Slab test against [t_min, *t_max], where *t_max is the closest hit
+    // so far. With the direction's sign known, the near plane of each slab
+    // is bounds[sign] and the far plane bounds[1 - sign].
+    auto near = t_min;
+    auto far = *t_max;
+    for (int a = 0; a < 3 && near < far; ++a) {
+      auto t0 = (node.bounds[direction_is_negative[a]][a] - origin[a]) *
+                inv_direction[a];
+      auto t1 = (node.bounds[1 - direction_is_negative[a]][a] - origin[a]) *
+                inv_direction[a];
+      near = t0 > near ? t0 : near;
+      far = t1 < far ? t1 : far;
+    }
+
+    if (near < far) {
+      if (node.primitive_count > 0) {
+        if (visit_leaf(node.offset, node.primitive_count)) {
+          return true;
+        }
+      } else if (kNearestFirst && direction_is_negative[node.axis]) {
+        stack[stack_size++] = current + 1;
+        current = node.offset;
+        continue;
+      } else {
+        stack[stack_size++] = node.offset;
+        current = current + 1;
+        continue;
+      }
+    }
+    if (stack_size == 0) {
+      return false;
+    }
+    current = stack[--stack_size];
+  }
+}
+
+bool LinearBvh::FindHit(const Ray& r, double t_min, double t_max,
+                        HitRecord* hit_record) const {
+  bool hit_anything = false;
+  Traverse<true>(nodes_, r, t_min, &t_max, [&](int32_t first, int count) {
+    for (int i = 0; i < count; ++i) {
+      if (primitives_[first + i]->FindHit(r, t_min, t_max, hit_record)) {
+        hit_anything = true;
+        t_max = hit_record->t;
+      }
+    }
+    return false;
+  });
+  return hit_anything;
+}
+
+bool LinearBvh::Occluded(const Ray& r, double t_min, double t_max) const {
+  // Any blocker will do, so children are visited in node order and the
+  // traversal stops at the first primitive that blocks the ray.
+  return Traverse<false>(
+      nodes_, r, t_min, &t_max, [&](int32_t first, int count) {
+        for (int i = 0; i < count; ++i) {
+          if (primitives_[first + i]->Occluded(r, t_min, t_max)) {
+            return true;
+          }
+        }
+        return false;
+      });
+}
+
+bool LinearBvh::BoundingBox(double time0, double time1,
+                            Aabb* output_box) const {
+  *output_box = box_;
+  return !nodes_.empty();
+}
+
+#pragma endregion  // RAY_TRACING_ONE_WEEK_LINEAR_BVH_H
@@ -0,0 +1,527 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "object/triangle_mesh.h"
+#include "utility/mapped_file.h"
+
+// Loaders of triangle meshes from Wavefront OBJ and binary PLY files. Files
+// are memory-mapped and parsed in place, without iostreams or a copy of the
+// text, and polygons are split into triangle fans. On failure, they print
+// the problem and return false.
+
+// Vertex indices are 32-bit, so a mesh holds fewer vertices than this.
+const int64_t kMaxMeshVertices = int64_t{1} << 32;
+
+// Cursor over the text of a mapped file.
+class MeshText {
+ public:
+  MeshText(const char* begin, const char* end) : p_(begin), end_(end) {}
+
+  [[nodiscard]] bool AtEnd() const { return p_ >= end_; }
+  // Returns the rest of the line, moving past its end.
+  std::string_view Line() {
+    const auto* begin = p_;
+    const auto* newline =
+        static_cast<const char*>(std::memchr(p_, '\n', end_ - p_));
+    p_ = newline != nullptr ? newline + 1 : end_;
+    auto length = (newline != nullptr ? newline : end_) - begin;
+    if (length > 0 && begin[length - 1] == '\r') {
+      --length;
+    }
+    return {begin, static_cast<size_t>(length)};
+  }
+  [[nodiscard]] const char* Position() const { return p_; }
+
+ private:
+  const char* p_;
+  const char* end_;
+};
+
+// Splits `line` at spaces and tabs into `tokens`, whose storage is reused
+// from line to line.
+void SplitMeshLine(std::string_view line,
+                   std::vector<std::string_view>* tokens) {
+  tokens->clear();
+  size_t i = 0;
+  while (i < line.size()) {
+    while (i < line.size() && (line[i] == ' ' || line[i] == '\t')) {
+      ++i;
+    }
+    auto start = i;
+    while (i < line.size() && line[i] != ' ' && line[i] != '\t') {
+      ++i;
+    }
+    if (i > start) {
+      tokens->push_back(line.substr(start, i - start));
+    }
+  }
+}
+
+template <typename T>
+bool ParseMeshNumber(std::string_view token, T* value) {
+  auto [end, error] =
+      std::from_chars(token.data(), token.data() + token.size(), *value);
+  return error == std::errc() && end == token.data() + token.size();
+}
+
+// Reads the v, vt, vn and f statements of an OBJ file; faces may index
+// positions, uvs and normals separately, in which case every distinct
+// combination becomes a vertex of the mesh.
+bool LoadObj(const std::string& path, MeshData* mesh) {
+  MappedFile file(path);
+  if (file.Data() == nullptr) {
+    std::cerr << "ERROR: Could not open mesh file '" << path << "'."
+              << std::endl;
+    return false;
+  }
+  const auto* begin = reinterpret_cast<const char*>(file.Data());
+  const auto* end = begin + file.Size();
+
+  // Without vt and vn statements, face indices are position indices and
+  // the positions become the mesh's vertices as they are.
+  bool has_attributes = false;
+  for (MeshText text(begin, end); !text.AtEnd();) {
+    auto line = text.Line();
+    if (line.size() > 2 && line[0] == 'v' &&
+        (line[1] == 't' || line[1] == 'n')) {
+      has_attributes = true;
+      break;
+    }
+  }
+
+  *mesh = MeshData();
+  std::vector<float> positions;
+  std::vector<float> uvs;
+  std::vector<float> normals;
+  struct CornerHash {
+    size_t operator()(const std::array<int64_t, 3>& corner) const {
+      return std::hash<int64_t>()(corner[0] * 73856093 ^
+                                  corner[1] * 19349663 ^ corner[2]);
+    }
+  };
+  std::unordered_map<std::array<int64_t, 3>, uint32_t, CornerHash> vertices;
+  std::vector<uint32_t> polygon;
+  std::vector<std::string_view> tokens;
+  long line_number = 0;
+
+  auto fail = [&](const char* problem) {
+    std::cerr << "ERROR: " << path << ":" << line_number << ": " << problem
+              << std::endl;
+    return false;
+  };
+  // Resolves a 1-based or negative (relative to the end) OBJ index into
+  // [0, count), or returns -1.
+  auto resolve = [](long index, size_t count) -> int64_t {
+    auto size = static_cast<long>(count);
+    auto resolved = index < 0 ? size + index : index - 1;
+    return resolved >= 0 && resolved < size ? resolved : -1;
+  };
+
+  for (MeshText text(begin, end); !text.AtEnd();) {
+    auto line = text.Line();
+    ++line_number;
+    SplitMeshLine(line, &tokens);
+    if (tokens.empty() || tokens[0][0] == '#') {
+      continue;
+    }
+    const auto& keyword = tokens[0];
+    if (keyword == "v" || keyword == "vn" || keyword == "vt") {
+      auto components = keyword == "vt" ? 2 : 3;
+      if (static_cast<int>(tokens.size()) < components + 1) {
+        return fail("too few coordinates");
+      }
+      auto& values = keyword == "v"    ? positions
+                     : keyword == "vn" ? normals
+                                       : uvs;
+      if (keyword == "v" &&
+          static_cast<int64_t>(positions.size() / 3) >= kMaxMeshVertices) {
+        return fail("too many vertices");
+      }
+      for (int c = 0; c < components; ++c) {
+        float value;
+        if (!ParseMeshNumber(tokens[c + 1], &value)) {
+          return fail("malformed number");
+        }
+        values.push_back(value);
+      }
+    } else if (keyword == "f") {
+      polygon.clear();
+      for (size_t i = 1; i < tokens.size(); ++i) {
+        // v, v/vt, v//vn or v/vt/vn.
+        std::array<int64_t, 3> corner = {-1, -1, -1};
+        auto token = tokens[i];
+        for (int part = 0; part < 3 && !token.empty(); ++part) {
+          auto slash = token.find('/');
+          auto field = token.substr(0, slash);
+          if (!field.empty()) {
+            long index;
+            if (!ParseMeshNumber(field, &index)) {
+              return fail("malformed index");
+            }
+            const auto& values = part == 0   ? positions
+                                 : part == 1 ? uvs
+                                             : normals;
+            corner[part] =
+                resolve(index, values.size() / (part == 1 ? 2 : 3));
+            if (corner[part] < 0) {
+              return fail("index out of range");
+            }
+          }
+          token = slash == std::string_view::npos ? std::string_view()
+                                                  : token.substr(slash + 1);
+        }
+        if (corner[0] < 0) {
+          return fail("face corner without a position");
+        }
+        if (!has_attributes) {
+          polygon.push_back(static_cast<uint32_t>(corner[0]));
+          continue;
+        }
+        if (static_cast<int64_t>(mesh->VertexCount()) >= kMaxMeshVertices) {
+          return fail("too many vertices");
+        }
+        auto [it, inserted] = vertices.emplace(
+            corner, static_cast<uint32_t>(mesh->VertexCount()));
+        if (inserted) {
+          for (int a = 0; a < 3; ++a) {
+            mesh->positions.push_back(positions[3 * corner[0] + a]);
+            mesh->normals.push_back(
+                corner[2] >= 0 ? normals[3 * corner[2] + a] : 0.0f);
+          }
+          for (int a = 0; a < 2; ++a) {
+            mesh->uvs.push_back(corner[1] >= 0 ? uvs[2 * corner[1] + a]
+                                               : 0.0f);
+          }
+        }
+        polygon.push_back(it->second);
+      }
+      if (polygon.size() < 3) {
+        return fail("face with fewer than 3 vertices");
+      }
+      for (size_t i = 2; i < polygon.size(); ++i) {
+        mesh->indices.insert(mesh->indices.end(),
+                             {polygon[0], polygon[i - 1], polygon[i]});
+      }
+    }
+  }
+
+  if (!has_attributes) {
+    mesh->positions = std::move(positions);
+  } else {
+    // Attributes no face refers to carry no information.
+    if (normals.empty()) {
+      mesh->normals.clear();
+    }
+    if (uvs.empty()) {
+      mesh->uvs.clear();
+    }
+  }
+  return true;
+}
+
+// Reads the vertex (x, y, z, and optionally nx, ny, nz and u, v or s, t)
+// and face (vertex_indices) elements of a binary PLY file of either byte
+// order. Other elements and properties are skipped.
+bool LoadPly(const std::string& path, MeshData* mesh) {
+  MappedFile file(path);
+  if (file.Data() == nullptr) {
+    std::cerr << "ERROR: Could not open mesh file '" << path << "'."
+              << std::endl;
+    return false;
+  }
+  auto fail = [&](const std::string& problem) {
+    std::cerr << "ERROR: " << path << ": " << problem << std::endl;
+    return false;
+  };
+  const auto* begin = reinterpret_cast<const char*>(file.Data());
+  const auto* end = begin + file.Size();
+
+  // Scalar types by size in bytes, with whether they are floating point or
+  // signed.
+  struct Type {
+    int size{};
+    bool floating{};
+    bool is_signed{};
+  };
+  auto parse_type = [](std::string_view name, Type* type) {
+    static const std::pair<const char*, Type> kTypes[] = {
+        {"char", {1, false, true}},    {"int8", {1, false, true}},
+        {"uchar", {1, false, false}},  {"uint8", {1, false, false}},
+        {"short", {2, false, true}},   {"int16", {2, false, true}},
+        {"ushort", {2, false, false}}, {"uint16", {2, false, false}},
+        {"int", {4, false, true}},     {"int32", {4, false, true}},
+        {"uint", {4, false, false}},   {"uint32", {4, false, false}},
+        {"float", {4, true, true}},    {"float32", {4, true, true}},
+        {"double", {8, true, true}},   {"float64", {8, true, true}},
+    };
+    for (const auto& [type_name, value] : kTypes) {
+      if (name == type_name) {
+        *type = value;
+        return true;
+      }
+    }
+    return false;
+  };
+  struct Property {
+    std::string name;
+    Type type;
+    // For lists, the type of the element count before the values.
+    bool list{};
+    Type count_type;
+  };
+  struct Element {
+    std::string name;
+    long count{};
+    std::vector<Property> properties;
+  };
+
+  // Header.
+  MeshText text(begin, end);
+  if (text.Line() != "ply") {
+    return fail("not a PLY file");
+  }
+  bool big_endian = false;
+  std::vector<Element> elements;
+  std::vector<std::string_view> tokens;
+  while (true) {
+    if (text.AtEnd()) {
+      return fail("header without end_header");
+    }
+    SplitMeshLine(text.Line(), &tokens);
+    if (tokens.empty() || tokens[0] == "comment" || tokens[0] == "obj_info") {
+      continue;
+    }
+    if (tokens[0] == "end_header") {
+      break;
+    }
+    if (tokens[0] == "format" && tokens.size() >= 2) {
+      if (tokens[1] == "binary_big_endian") {
+        big_endian = true;
+      } else if (tokens[1] != "binary_little_endian") {
+        return fail("unsupported format " + std::string(tokens[1]) +
+                    ", only binary PLY files are read");
+      }
+    } else if (tokens[0] == "element" && tokens.size() == 3) {
+      Element element{std::string(tokens[1])};
+      if (!ParseMeshNumber(tokens[2], &element.count) || element.count < 0) {
+        return fail("malformed element count");
+      }
+      elements.push_back(element);
+    } else if (tokens[0] == "property" && !elements.empty()) {
+      Property property;
+      bool valid;
+      if (tokens.size() == 5 && tokens[1] == "list") {
+        property.list = true;
+        property.name = tokens[4];
+        valid = parse_type(tokens[2], &property.count_type) &&
+                !property.count_type.floating &&
+                parse_type(tokens[3], &property.type);
+      } else {
+        property.name = tokens.size() == 3 ? tokens[2] : "";
+        valid = tokens.size() == 3 && parse_type(tokens[1], &property.type);
+      }
+      if (!valid) {
+        return fail("malformed property");
+      }
+      // Indices are cast to uint32_t, which NaN or fractions would break.
+      if (property.list && property.type.floating &&
+          (property.name == "vertex_indices" ||
+           property.name == "vertex_index")) {
+        return fail("floating point " + property.name);
+      }
+      elements.back().properties.push_back(property);
+    } else {
+      return fail("malformed header line");
+    }
+  }
+
+  // Body.
+  const auto* p = text.Position();
+  auto read = [&](const Type& type, double* value) {
+    if (end - p < type.size) {
+      return false;
+    }
+    unsigned char bytes[8];
+    std::memcpy(bytes, p, type.size);
+    p += type.size;
+    if (big_endian) {
+      std::reverse(bytes, bytes + type.size);
+    }
+    switch (type.size) {
+      case 1:
+        *value = type.is_signed ? static_cast<int8_t>(bytes[0]) : bytes[0];
+        return true;
+      case 2: {
+        uint16_t bits;
+        std::memcpy(&bits, bytes, 2);
+        *value = type.is_signed ? static_cast<int16_t>(bits) : bits;
+        return true;
+      }
+      case 4: {
+        uint32_t bits;
+        std::memcpy(&bits, bytes, 4);
+        if (type.floating) {
+          float f;
+          std::memcpy(&f, &bits, 4);
+          *value = f;
+        } else {
+          *value = type.is_signed ? static_cast<int32_t>(bits) : bits;
+        }
+        return true;
+      }
+      default: {
+        std::memcpy(value, bytes, 8);
+        return true;
+      }
+    }
+  };
+
+  *mesh = MeshData();
+  long vertex_count = -1;
+  std::vector<uint32_t> polygon;
+  for (const auto& element : elements) {
+    // Where each property goes: 0-2 position, 3-5 normal, 6-7 uv, -1 none.
+    std::vector<int> slots;
+    bool has_normals = false;
+    bool has_uvs = false;
+    int index_list = -1;
+    for (size_t i = 0; i < element.properties.size(); ++i) {
+      const auto& name = element.properties[i].name;
+      static const char* const kSlots[][2] = {
+          {"x", nullptr},  {"y", nullptr},  {"z", nullptr},
+          {"nx", nullptr}, {"ny", nullptr}, {"nz", nullptr},
+          {"u", "s"},      {"v", "t"}};
+      int slot = -1;
+      for (int s = 0; s < 8; ++s) {
+        if (name == kSlots[s][0] ||
+            (kSlots[s][1] != nullptr && name == kSlots[s][1]) ||
+            name == std::string("texture_") + kSlots[s][0]) {
+          slot = s;
+        }
+      }
+      slots.push_back(element.properties[i].list ? -1 : slot);
+      has_normals |= slot >= 3 && slot < 6;
+      has_uvs |= slot >= 6;
+      if (element.properties[i].list &&
+          (name == "vertex_indices" || name == "vertex_index")) {
+        index_list = static_cast<int>(i);
+      }
+    }
+
+    bool is_vertex = element.name == "vertex";
+    bool is_face = element.name == "face";
+    // Check the counts of the header against the size of the file before
+    // allocating for them: every item takes at least its scalars and list
+    // counts.
+    long min_item_size = 0;
+    for (const auto& property : element.properties) {
+      min_item_size +=
+          property.list ? property.count_type.size : property.type.size;
+    }
+    if (element.count > 0 &&
+        (min_item_size == 0 || element.count > (end - p) / min_item_size)) {
+      return fail("element count " + std::to_string(element.count) +
+                  " larger than the data");
+    }
+    if (is_vertex && element.count >= kMaxMeshVertices) {
+      return fail("too many vertices");
+    }
+    if (is_vertex) {
+      vertex_count = element.count;
+      mesh->positions.resize(3 * element.count);
+      if (has_normals) {
+        mesh->normals.resize(3 * element.count);
+      }
+      if (has_uvs) {
+        mesh->uvs.resize(2 * element.count);
+      }
+    }
+    if (is_face) {
+      if (vertex_count < 0 || index_list < 0) {
+        return fail("faces without vertices or vertex_indices");
+      }
+      mesh->indices.reserve(3 * element.count);
+    }
+
+    for (long item = 0; item < element.count; ++item) {
+      for (size_t i = 0; i < element.properties.size(); ++i) {
+        const auto& property = element.properties[i];
+        double value;
+        if (!property.list) {
+          if (!read(property.type, &value)) {
+            return fail("truncated data");
+          }
+          auto slot = slots[i];
+          if (is_vertex && slot >= 0) {
+            auto f = static_cast<float>(value);
+            if (slot < 3) {
+              mesh->positions[3 * item + slot] = f;
+            } else if (slot < 6) {
+              mesh->normals[3 * item + slot - 3] = f;
+            } else {
+              mesh->uvs[2 * item + slot - 6] = f;
+            }
+          }
+          continue;
+        }
+        double count;
+        if (!read(property.count_type, &count) || count < 0) {
+          return fail("truncated data");
+        }
+        bool keep = is_face && static_cast<int>(i) == index_list;
+        polygon.clear();
+        for (long n = 0; n < static_cast<long>(count); ++n) {
+          if (!read(property.type, &value)) {
+            return fail("truncated data");
+          }
+          if (keep) {
+            if (value < 0 || value >= static_cast<double>(vertex_count)) {
+              return fail("vertex index out of range");
+            }
+            polygon.push_back(static_cast<uint32_t>(value));
+          }
+        }
+        if (keep) {
+          if (polygon.size() < 3) {
+            return fail("face with fewer than 3 vertices");
+          }
+          for (size_t k = 2; k < polygon.size(); ++k) {
+            mesh->indices.insert(mesh->indices.end(),
+                                 {polygon[0], polygon[k - 1], polygon[k]});
+          }
+        }
+      }
+    }
+  }
+  return true;
+}
+
+// Loads an .obj or .ply file by its extension.
+bool LoadMesh(const std::string& path, MeshData* mesh) {
+  auto extension = path.substr(path.rfind('.') + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  if (extension == "obj") {
+    return LoadObj(path, mesh);
+  }
+  if (extension == "ply") {
+    return LoadPly(path, mesh);
+  }
+  std::cerr << "ERROR: Unknown mesh format '" << extension << "'."
+            << std::endl;
+  return false;
+}
+
+#pragma endregion  // RAY_TRACING_ONE_WEEK_MESH_LOADER_H
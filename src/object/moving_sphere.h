@@ -16,13 +16,28 @@ class MovingSphere : public Hittable {
         time0_(time0),
         time1_(time1),
         radius_(radius),
-        material_(std::move(mat)) {}
+        material_(DefaultMaterialTable().Add(std::move(mat))) {
+    // Scenes rendered without motion blur pass an empty shutter interval.
+    if (time1_ != time0_) {
+      velocity_ = (center1_ - center0_) / (time1_ - time0_);
+    }
+  }
 
-  bool Hit(const Ray& r, double t_min, double t_max,
-           HitRecord* hit_record) const override;
+  bool FindHit(const Ray& r, double t_min, double t_max,
+               HitRecord* hit_record) const override;
+  void CompleteHit(const Ray& r, HitRecord* hit_record) const override {
+    RT_STATS_ADD(hits_completed, 1);
+    SetHitRecord(r, hit_record->t, hit_record);
+  }
   bool BoundingBox(double time0, double time1, Aabb* output_box) const override;
+  bool Occluded(const Ray& r, double t_min, double t_max) const override;
+  bool MotionBounds(double time0, double time1, Aabb* start_box,
+                    Aabb* end_box) const override;
 
   [[nodiscard]] Point3 Center(double time) const;
+  // Fills `hit_record` for a hit of `r` at `root`, as found by FindHit or
+  // by the BVH's SIMD test of several spheres.
+  void SetHitRecord(const Ray& r, double root, HitRecord* hit_record) const;
 
  public:
   Point3 center0_;
@@ -30,16 +45,28 @@ class MovingSphere : public Hittable {
   double time0_{};
   double time1_{};
   double radius_{};
-  std::shared_ptr<Material> material_;
+  MaterialId material_{};
+  // Displacement per unit of time, zero for an empty shutter interval.
+  Vec3 velocity_;
 };
 
 Point3 MovingSphere::Center(double time) const {
-  return center0_ +
-         ((time - time0_) / (time1_ - time0_)) * (center1_ - center0_);
+  return center0_ + (time - time0_) * velocity_;
+}
+
+void MovingSphere::SetHitRecord(const Ray& r, double root,
+                                HitRecord* hit_record) const {
+  hit_record->t = root;
+  hit_record->p = r.At(root);
+  auto outward_normal = (hit_record->p - this->Center(r.Time())) / radius_;
+  hit_record->SetFaceNormal(r, outward_normal);
+  hit_record->material = material_;
 }
 
-bool MovingSphere::Hit(const Ray& r, double t_min, double t_max,
-                       HitRecord* hit_record) const {
+bool MovingSphere::FindHit(const Ray& r, double t_min, double t_max,
+                           HitRecord* hit_record) const {
+  RT_STATS_ADD(
+      primitive_tests[static_cast<int>(PrimitiveType::kMovingSphere)], 1);
   auto oc = r.Origin() - this->Center(r.Time());
   auto a = r.Direction().LengthSquared();
   auto b = 2.0f * Dot(oc, r.Direction());
@@ -56,16 +83,31 @@ bool MovingSphere::Hit(const Ray& r, double t_min, double t_max,
       }
     }
     hit_record->t = root;
-    hit_record->p = r.At(root);
-    auto outward_normal = (hit_record->p - this->Center(r.Time())) / radius_;
-    hit_record->SetFaceNormal(r, outward_normal);
-    hit_record->material = material_;
-
+    hit_record->primitive = this;
     return true;
   }
   return false;
 }
 
+bool MovingSphere::Occluded(const Ray& r, double t_min,
+                            double t_max) const {
+  RT_STATS_ADD(
+      primitive_tests[static_cast<int>(PrimitiveType::kMovingSphere)], 1);
+  auto oc = r.Origin() - this->Center(r.Time());
+  auto a = r.Direction().LengthSquared();
+  auto b = 2.0f * Dot(oc, r.Direction());
+  auto c = oc.LengthSquared() - radius_ * radius_;
+  auto discriminant = b * b - 4 * a * c;
+  if (discriminant < 0) {
+    return false;
+  }
+  auto sqrt_d = sqrt(discriminant);
+  auto near_root = (-b - sqrt_d) / (2 * a);
+  auto far_root = (-b + sqrt_d) / (2 * a);
+  return (near_root >= t_min && near_root <= t_max) ||
+         (far_root >= t_min && far_root <= t_max);
+}
+
 bool MovingSphere::BoundingBox(double time0, double time1,
                                Aabb* output_box) const {
   Aabb box0(this->Center(time0) - Vec3(radius_, radius_, radius_),
@@ -76,4 +118,13 @@ bool MovingSphere::BoundingBox(double time0, double time1,
   return true;
 }
 
+bool MovingSphere::MotionBounds(double time0, double time1, Aabb* start_box,
+                                Aabb* end_box) const {
+  // The center moves linearly, so the interpolated boxes are exact.
+  auto r = Vec3(radius_, radius_, radius_);
+  *start_box = Aabb(Center(time0) - r, Center(time0) + r);
+  *end_box = Aabb(Center(time1) - r, Center(time1) + r);
+  return true;
+}
+
 #pragma endregion
@@ -8,6 +8,13 @@ class RotateY : public Hittable {
 
   bool Hit(const Ray& r, double t_min, double t_max,
            HitRecord* rec) const override;
+  bool FindHit(const Ray& r, double t_min, double t_max,
+               HitRecord* rec) const override {
+    return FindCompletedHit(r, t_min, t_max, rec);
+  }
+  bool Occluded(const Ray& r, double t_min, double t_max) const override {
+    return ptr_->Occluded(Rotate(r), t_min, t_max);
+  }
 
   bool BoundingBox(double time0, double time1,
                    Aabb* output_box) const override {
@@ -16,6 +23,9 @@ class RotateY : public Hittable {
   }
 
  public:
+  // `r` in the frame of ptr_.
+  [[nodiscard]] Ray Rotate(const Ray& r) const;
+
   std::shared_ptr<Hittable> ptr_;
   double sin_theta_;
   double cos_theta_;
@@ -55,8 +65,7 @@ RotateY::RotateY(std::shared_ptr<Hittable> p, double angle) : ptr_(p) {
   bbox_ = Aabb(min, max);
 }
 
-bool RotateY::Hit(const Ray& r, double t_min, double t_max,
-                  HitRecord* rec) const {
+Ray RotateY::Rotate(const Ray& r) const {
   auto origin = r.Origin();
   auto direction = r.Direction();
 
@@ -66,7 +75,12 @@ bool RotateY::Hit(const Ray& r, double t_min, double t_max,
   direction[0] = cos_theta_ * r.Direction()[0] - sin_theta_ * r.Direction()[2];
   direction[2] = sin_theta_ * r.Direction()[0] + cos_theta_ * r.Direction()[2];
 
-  Ray rotated_r(origin, direction, r.Time());
+  return {origin, direction, r.Time(), r.GetSampler()};
+}
+
+bool RotateY::Hit(const Ray& r, double t_min, double t_max,
+                  HitRecord* rec) const {
+  auto rotated_r = Rotate(r);
 
   if (!ptr_->Hit(rotated_r, t_min, t_max, rec)) {
     return false;
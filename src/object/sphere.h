@@ -1,9 +1,11 @@
 #pragma once
 
+#include <bit>
 #include <memory>
 #include <utility>
 
 #include "hittable.h"
+#include "utility/simd.h"
 #include "utility/vec3.h"
 
 class Sphere : public Hittable {
@@ -13,14 +15,34 @@ class Sphere : public Hittable {
     radius_ = 1.0;
   }
   Sphere(const Point3& center, double radius, shared_ptr<Material> material)
-      : center_(center), radius_(radius), material_(std::move(material)) {}
-  bool Hit(const Ray& r, double t_min, double t_max,
-           HitRecord* hit_record) const override;
+      : center_(center),
+        radius_(radius),
+        material_(DefaultMaterialTable().Add(std::move(material))) {}
+  bool FindHit(const Ray& r, double t_min, double t_max,
+               HitRecord* hit_record) const override;
+  void CompleteHit(const Ray& r, HitRecord* hit_record) const override {
+    RT_STATS_ADD(hits_completed, 1);
+    SetHitRecord(r, hit_record->t, hit_record);
+  }
   bool BoundingBox(double time0, double time1, Aabb* output_box) const override;
+  bool Occluded(const Ray& r, double t_min, double t_max) const override;
+  void HitPacket(const RayPacket& packet, unsigned int active, double t_min,
+                 PacketHit* hit) const override;
+
+  // Fills `hit_record` for a hit of `r` at `root`, as found by FindHit or
+  // by the BVH's SIMD test of several spheres.
+  void SetHitRecord(const Ray& r, double root, HitRecord* hit_record) const {
+    hit_record->t = root;
+    hit_record->p = r.At(root);
+    auto outward_normal = (hit_record->p - center_) / radius_;
+    hit_record->SetFaceNormal(r, outward_normal);
+    GetSphereUV(outward_normal, &hit_record->u, &hit_record->v);
+    hit_record->material = material_;
+  }
 
   Point3 center_;
   double radius_;
-  std::shared_ptr<Material> material_;
+  MaterialId material_{};
 
  private:
   static void GetSphereUV(const Point3& p, double* u, double* v) {
@@ -32,8 +54,9 @@ class Sphere : public Hittable {
   }
 };
 
-bool Sphere::Hit(const Ray& r, double t_min, double t_max,
-                 HitRecord* hit_record) const {
+bool Sphere::FindHit(const Ray& r, double t_min, double t_max,
+                     HitRecord* hit_record) const {
+  RT_STATS_ADD(primitive_tests[static_cast<int>(PrimitiveType::kSphere)], 1);
   auto oc = r.Origin() - center_;
   auto a = r.Direction().LengthSquared();
   auto b = 2.0f * Dot(oc, r.Direction());
@@ -50,17 +73,87 @@ bool Sphere::Hit(const Ray& r, double t_min, double t_max,
       }
     }
     hit_record->t = root;
-    hit_record->p = r.At(root);
-    auto outward_normal = (hit_record->p - center_) / radius_;
-    hit_record->SetFaceNormal(r, outward_normal);
-    GetSphereUV(outward_normal, &hit_record->u, &hit_record->v);
-    hit_record->material = material_;
-
+    hit_record->primitive = this;
     return true;
   }
   return false;
 }
 
+bool Sphere::Occluded(const Ray& r, double t_min, double t_max) const {
+  RT_STATS_ADD(primitive_tests[static_cast<int>(PrimitiveType::kSphere)], 1);
+  auto oc = r.Origin() - center_;
+  auto a = r.Direction().LengthSquared();
+  auto b = 2.0f * Dot(oc, r.Direction());
+  auto c = oc.LengthSquared() - radius_ * radius_;
+  auto discriminant = b * b - 4 * a * c;
+  if (discriminant < 0) {
+    return false;
+  }
+  auto sqrt_d = sqrt(discriminant);
+  auto near_root = (-b - sqrt_d) / (2 * a);
+  auto far_root = (-b + sqrt_d) / (2 * a);
+  return (near_root >= t_min && near_root <= t_max) ||
+         (far_root >= t_min && far_root <= t_max);
+}
+
+void Sphere::HitPacket(const RayPacket& packet, unsigned int active,
+                       double t_min, PacketHit* hit) const {
+  // The same quadratic as FindHit, evaluated in the same order for kSimdWidth
+  // lanes at once, so both report bit-identical roots.
+  constexpr unsigned int kChunkMask = (1u << kSimdWidth) - 1;
+  alignas(64) double roots[kSimdWidth];
+  RT_STATS_ADD(primitive_tests[static_cast<int>(PrimitiveType::kSphere)],
+               std::popcount(active));
+
+  for (int base = 0; base < kPacketSize; base += kSimdWidth) {
+    auto chunk = (active >> base) & kChunkMask;
+    if (chunk == 0) {
+      continue;
+    }
+    SimdDouble oc[3];
+    SimdDouble direction[3];
+    for (int axis = 0; axis < 3; ++axis) {
+      oc[axis] = SimdDouble::Load(packet.origin[axis] + base) -
+                 SimdDouble::Broadcast(center_[axis]);
+      direction[axis] = SimdDouble::Load(packet.direction[axis] + base);
+    }
+    auto a = direction[0] * direction[0] + direction[1] * direction[1] +
+             direction[2] * direction[2];
+    auto b = SimdDouble::Broadcast(2.0) *
+             (oc[0] * direction[0] + oc[1] * direction[1] +
+              oc[2] * direction[2]);
+    auto c = (oc[0] * oc[0] + oc[1] * oc[1] + oc[2] * oc[2]) -
+             SimdDouble::Broadcast(radius_ * radius_);
+    auto discriminant = b * b - SimdDouble::Broadcast(4) * a * c;
+    auto sqrt_d = Sqrt(discriminant);
+
+    auto lo = SimdDouble::Broadcast(t_min);
+    auto hi = SimdDouble::Load(hit->t_max + base);
+    auto neg_b = SimdDouble::Broadcast(-1) * b;
+    auto two_a = SimdDouble::Broadcast(2) * a;
+    auto near_root = (neg_b - sqrt_d) / two_a;
+    auto far_root = (neg_b + sqrt_d) / two_a;
+    auto near_ok = (lo <= near_root) & (near_root <= hi);
+    auto far_ok = (lo <= far_root) & (far_root <= hi);
+    auto real_roots = discriminant >= SimdDouble::Broadcast(0);
+    auto hits = (real_roots & (near_ok | far_ok)).Bits() & chunk;
+    if (hits == 0) {
+      continue;
+    }
+
+    Select(near_ok, near_root, far_root).Store(roots);
+    for (int lane = 0; lane < kSimdWidth; ++lane) {
+      if (((hits >> lane) & 1) != 0) {
+        auto index = base + lane;
+        hit->records[index].t = roots[lane];
+        hit->records[index].primitive = this;
+        hit->t_max[index] = roots[lane];
+        hit->mask |= 1u << index;
+      }
+    }
+  }
+}
+
 bool Sphere::BoundingBox(double time0, double time1, Aabb* output_box) const {
   *output_box = Aabb(center_ - Vec3(radius_, radius_, radius_),
                      center_ + Vec3(radius_, radius_, radius_));
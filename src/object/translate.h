@@ -11,9 +11,20 @@ class Translate : public Hittable {
 
   bool Hit(const Ray& r, double t_min, double t_max,
            HitRecord* rec) const override;
+  bool FindHit(const Ray& r, double t_min, double t_max,
+               HitRecord* rec) const override {
+    return FindCompletedHit(r, t_min, t_max, rec);
+  }
 
   bool BoundingBox(double time0, double time1, Aabb* output_box) const override;
 
+  [[nodiscard]] const std::shared_ptr<Hittable>& Object() const { return ptr; }
+
+  bool Occluded(const Ray& r, double t_min, double t_max) const override {
+    Ray moved_r(r.Origin() - offset, r.Direction(), r.Time(), r.GetSampler());
+    return ptr->Occluded(moved_r, t_min, t_max);
+  }
+
  private:
   std::shared_ptr<Hittable> ptr;
   Vec3 offset;
@@ -21,7 +32,7 @@ class Translate : public Hittable {
 
 bool Translate::Hit(const Ray& r, double t_min, double t_max,
                     HitRecord* rec) const {
-  Ray moved_r(r.Origin() - offset, r.Direction(), r.Time());
+  Ray moved_r(r.Origin() - offset, r.Direction(), r.Time(), r.GetSampler());
   if (!ptr->Hit(moved_r, t_min, t_max, rec)) {
     return false;
   }
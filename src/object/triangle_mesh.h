@@ -0,0 +1,333 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "object/bvh.h"
+#include "object/hittable.h"
+#include "object/linear_bvh.h"
+#include "utility/parallel.h"
+#include "utility/rtweekend.h"
+#include "utility/simd.h"
+#include "utility/stats.h"
+
+// Vertex and index buffers of a triangle mesh. Attributes are floats, which
+// halves the memory of large meshes; normals and uvs are either empty or
+// hold one entry per vertex.
+struct MeshData {
+  // x, y, z of every vertex.
+  std::vector<float> positions;
+  // x, y, z of every vertex's shading normal.
+  std::vector<float> normals;
+  // u, v of every vertex.
+  std::vector<float> uvs;
+  // Three vertex indices per triangle, counterclockwise seen from the
+  // front; every index is below VertexCount().
+  std::vector<uint32_t> indices;
+
+  [[nodiscard]] size_t VertexCount() const { return positions.size() / 3; }
+  [[nodiscard]] size_t TriangleCount() const { return indices.size() / 3; }
+};
+
+// An indexed triangle mesh with a BVH of its own over its triangles, in the
+// LinearBvh layout. The build reorders the triangles so that every leaf is
+// a range of them, which keeps the mesh at its index and vertex buffers
+// plus the nodes; leaves are intersected kSimdWidth triangles at a time
+// with the Moller-Trumbore test.
+class TriangleMesh : public Hittable {
+ public:
+  TriangleMesh(MeshData data, std::shared_ptr<Material> material)
+      : TriangleMesh(std::move(data), std::move(material),
+                     DefaultBvhBuildOptions()) {}
+  TriangleMesh(MeshData data, std::shared_ptr<Material> material,
+               const BvhBuildOptions& options);
+
+  bool FindHit(const Ray& r, double t_min, double t_max,
+               HitRecord* hit_record) const override;
+  // Reads the triangle from `part` and its barycentric coordinates from u
+  // and v, where FindHit leaves them.
+  void CompleteHit(const Ray& r, HitRecord* hit_record) const override {
+    RT_STATS_ADD(hits_completed, 1);
+    SetHitRecord(r, hit_record->part, hit_record->t, hit_record->u,
+                 hit_record->v, hit_record);
+  }
+  bool Occluded(const Ray& r, double t_min, double t_max) const override;
+  bool BoundingBox(double time0, double time1, Aabb* output_box) const override;
+
+  // Triangles in leaf order.
+  [[nodiscard]] const MeshData& Data() const { return data_; }
+  [[nodiscard]] const std::vector<LinearBvhNode>& Nodes() const {
+    return nodes_;
+  }
+
+ private:
+  // A triangle with its bounds, for SahSplit.
+  struct BuildTriangle {
+    Aabb box;
+    Point3 centroid;
+    uint32_t triangle;
+  };
+
+  [[nodiscard]] Point3 Vertex(uint32_t index) const {
+    const auto* p = &data_.positions[3 * static_cast<size_t>(index)];
+    return {p[0], p[1], p[2]};
+  }
+  // Tests the `count` triangles from `first` on. Returns the one with the
+  // nearest hit in [t_min, t_max], storing its distance and barycentric
+  // coordinates, or returns -1.
+  long HitTriangles(const Ray& r, uint32_t first, uint32_t count,
+                    double t_min, double t_max, double* t, double* u,
+                    double* v) const;
+  void SetHitRecord(const Ray& r, uint32_t triangle, double t, double u,
+                    double v, HitRecord* hit_record) const;
+
+  MeshData data_;
+  MaterialId material_;
+  std::vector<LinearBvhNode> nodes_;
+  Aabb box_;
+};
+
+TriangleMesh::TriangleMesh(MeshData data, std::shared_ptr<Material> material,
+                           const BvhBuildOptions& options)
+    : data_(std::move(data)),
+      material_(DefaultMaterialTable().Add(std::move(material))) {
+  RT_STATS_TIME(bvh_build_seconds);
+  auto start = std::chrono::steady_clock::now();
+  auto count = static_cast<long>(data_.TriangleCount());
+  if (count == 0) {
+    return;
+  }
+  auto threads = std::max(options.thread_count, 1);
+
+  std::vector<BuildTriangle> triangles(count);
+  ParallelFor(0, count, threads, [&](int, long first, long last) {
+    for (long i = first; i < last; ++i) {
+      const auto* index = &data_.indices[3 * i];
+      auto p0 = Vertex(index[0]);
+      auto p1 = Vertex(index[1]);
+      auto p2 = Vertex(index[2]);
+      Point3 min;
+      Point3 max;
+      for (int a = 0; a < 3; ++a) {
+        min[a] = std::min({p0[a], p1[a], p2[a]});
+        max[a] = std::max({p0[a], p1[a], p2[a]});
+        // Like the rectangles, pad flat boxes so that they have a width
+        // in every dimension.
+        if (max[a] - min[a] < 0.0001) {
+          min[a] -= 0.0001;
+          max[a] += 0.0001;
+        }
+      }
+      triangles[i] = {Aabb(min, max), 0.5 * (min + max),
+                      static_cast<uint32_t>(i)};
+    }
+  });
+  LinearBvh::Build(triangles, 0, count, 0, options, threads, &nodes_);
+  nodes_.shrink_to_fit();
+
+  // Store the indices in leaf order.
+  std::vector<uint32_t> indices(data_.indices.size());
+  box_ = triangles[0].box;
+  for (long i = 0; i < count; ++i) {
+    std::copy_n(&data_.indices[3 * triangles[i].triangle], 3, &indices[3 * i]);
+    box_ = Aabb::SurroundingBox(box_, triangles[i].box);
+  }
+  data_.indices = std::move(indices);
+
+  if (options.report) {
+    auto seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+    std::cerr << "Mesh BVH over " << count << " triangles built in "
+              << seconds << " seconds on " << threads << " threads: "
+              << nodes_.size() << " nodes" << std::endl;
+  }
+}
+
+long TriangleMesh::HitTriangles(const Ray& r, uint32_t first, uint32_t count,
+                                double t_min, double t_max, double* t,
+                                double* u, double* v) const {
+  RT_STATS_ADD(primitive_tests[static_cast<int>(PrimitiveType::kTriangle)],
+               count);
+  SimdDouble origin[3];
+  SimdDouble direction[3];
+  for (int a = 0; a < 3; ++a) {
+    origin[a] = SimdDouble::Broadcast(r.Origin()[a]);
+    direction[a] = SimdDouble::Broadcast(r.Direction()[a]);
+  }
+  auto zero = SimdDouble::Broadcast(0);
+  auto one = SimdDouble::Broadcast(1);
+  auto lo = SimdDouble::Broadcast(t_min);
+  // Corner 0 and the two edges from it of kSimdWidth triangles, gathered
+  // from the vertex buffer; lanes past the leaf stay degenerate and miss.
+  alignas(64) double corner[3][kSimdWidth];
+  alignas(64) double edge1[3][kSimdWidth];
+  alignas(64) double edge2[3][kSimdWidth];
+  alignas(64) double hit_t[kSimdWidth];
+  alignas(64) double hit_u[kSimdWidth];
+  alignas(64) double hit_v[kSimdWidth];
+  long nearest = -1;
+
+  for (uint32_t base = 0; base < count; base += kSimdWidth) {
+    auto lanes = std::min<uint32_t>(kSimdWidth, count - base);
+    for (uint32_t lane = 0; lane < kSimdWidth; ++lane) {
+      if (lane < lanes) {
+        const auto* index = &data_.indices[3 * (first + base + lane)];
+        auto p0 = Vertex(index[0]);
+        auto e1 = Vertex(index[1]) - p0;
+        auto e2 = Vertex(index[2]) - p0;
+        for (int a = 0; a < 3; ++a) {
+          corner[a][lane] = p0[a];
+          edge1[a][lane] = e1[a];
+          edge2[a][lane] = e2[a];
+        }
+      } else {
+        for (int a = 0; a < 3; ++a) {
+          corner[a][lane] = edge1[a][lane] = edge2[a][lane] = 0;
+        }
+      }
+    }
+    SimdDouble e1[3];
+    SimdDouble e2[3];
+    SimdDouble s[3];
+    for (int a = 0; a < 3; ++a) {
+      e1[a] = SimdDouble::Load(edge1[a]);
+      e2[a] = SimdDouble::Load(edge2[a]);
+      s[a] = origin[a] - SimdDouble::Load(corner[a]);
+    }
+    auto simd_cross = [](const SimdDouble* x, const SimdDouble* y,
+                    SimdDouble* result) {
+      result[0] = x[1] * y[2] - x[2] * y[1];
+      result[1] = x[2] * y[0] - x[0] * y[2];
+      result[2] = x[0] * y[1] - x[1] * y[0];
+    };
+    auto simd_dot = [](const SimdDouble* x, const SimdDouble* y) {
+      return x[0] * y[0] + x[1] * y[1] + x[2] * y[2];
+    };
+
+    SimdDouble p[3];
+    simd_cross(direction, e2, p);
+    auto determinant = simd_dot(e1, p);
+    auto inv_determinant = one / determinant;
+    auto bu = simd_dot(s, p) * inv_determinant;
+    SimdDouble q[3];
+    simd_cross(s, e1, q);
+    auto bv = simd_dot(direction, q) * inv_determinant;
+    auto distance = simd_dot(e2, q) * inv_determinant;
+
+    // Rays parallel to the plane have a zero determinant and miss.
+    auto hi = SimdDouble::Broadcast(t_max);
+    auto hits = ((determinant < zero) | (zero < determinant)) &
+                (zero <= bu) & (zero <= bv) & (bu + bv <= one) &
+                (lo <= distance) & (distance <= hi);
+    auto mask = hits.Bits();
+    if (mask == 0) {
+      continue;
+    }
+    distance.Store(hit_t);
+    bu.Store(hit_u);
+    bv.Store(hit_v);
+    for (uint32_t lane = 0; lane < lanes; ++lane) {
+      if (((mask >> lane) & 1) != 0 && hit_t[lane] < t_max) {
+        t_max = hit_t[lane];
+        *u = hit_u[lane];
+        *v = hit_v[lane];
+        nearest = first + base + lane;
+      }
+    }
+  }
+  *t = t_max;
+  return nearest;
+}
+
+void TriangleMesh::SetHitRecord(const Ray& r, uint32_t triangle, double t,
+                                double u, double v,
+                                HitRecord* hit_record) const {
+  const auto* index = &data_.indices[3 * static_cast<size_t>(triangle)];
+  auto w = 1 - u - v;
+  hit_record->t = t;
+  hit_record->p = r.At(t);
+
+  Vec3 normal;
+  if (!data_.normals.empty()) {
+    for (int a = 0; a < 3; ++a) {
+      normal[a] = w * data_.normals[3 * static_cast<size_t>(index[0]) + a] +
+                  u * data_.normals[3 * static_cast<size_t>(index[1]) + a] +
+                  v * data_.normals[3 * static_cast<size_t>(index[2]) + a];
+    }
+  }
+  if (data_.normals.empty() || normal.LengthSquared() == 0) {
+    auto p0 = Vertex(index[0]);
+    normal = cross(Vertex(index[1]) - p0, Vertex(index[2]) - p0);
+  }
+  hit_record->SetFaceNormal(r, UnitVector(normal));
+
+  if (data_.uvs.empty()) {
+    hit_record->u = u;
+    hit_record->v = v;
+  } else {
+    const auto& uvs = data_.uvs;
+    hit_record->u = w * uvs[2 * static_cast<size_t>(index[0])] +
+                    u * uvs[2 * static_cast<size_t>(index[1])] +
+                    v * uvs[2 * static_cast<size_t>(index[2])];
+    hit_record->v = w * uvs[2 * static_cast<size_t>(index[0]) + 1] +
+                    u * uvs[2 * static_cast<size_t>(index[1]) + 1] +
+                    v * uvs[2 * static_cast<size_t>(index[2]) + 1];
+  }
+  hit_record->material = material_;
+}
+
+bool TriangleMesh::FindHit(const Ray& r, double t_min, double t_max,
+                           HitRecord* hit_record) const {
+  long nearest = -1;
+  double nearest_u = 0;
+  double nearest_v = 0;
+  LinearBvh::Traverse<true>(
+      nodes_, r, t_min, &t_max, [&](int32_t first, int count) {
+        double t;
+        double u;
+        double v;
+        auto triangle =
+            HitTriangles(r, first, count, t_min, t_max, &t, &u, &v);
+        if (triangle >= 0) {
+          nearest = triangle;
+          t_max = t;
+          nearest_u = u;
+          nearest_v = v;
+        }
+        return false;
+      });
+
+  if (nearest < 0) {
+    return false;
+  }
+  hit_record->t = t_max;
+  hit_record->u = nearest_u;
+  hit_record->v = nearest_v;
+  hit_record->part = static_cast<uint32_t>(nearest);
+  hit_record->primitive = this;
+  return true;
+}
+
+bool TriangleMesh::Occluded(const Ray& r, double t_min, double t_max) const {
+  return LinearBvh::Traverse<false>(
+      nodes_, r, t_min, &t_max, [&](int32_t first, int count) {
+        double t;
+        double u;
+        double v;
+        return HitTriangles(r, first, count, t_min, t_max, &t, &u, &v) >= 0;
+      });
+}
+
+bool TriangleMesh::BoundingBox(double time0, double time1,
+                               Aabb* output_box) const {
+  *output_box = box_;
+  return !nodes_.empty();
+}
+
+#pragma endregion  // RAY_TRACING_ONE_WEEK_TRIANGLE_MESH_H
@@ -0,0 +1,1055 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "object/box.h"
+#include "object/bvh.h"
+#include "object/bvh_cache.h"
+#include "object/hittable.h"
+#include "object/hittable_list.h"
+#include "object/moving_sphere.h"
+#include "object/sphere.h"
+#include "utility/mapped_file.h"
+#include "utility/parallel.h"
+#include "utility/rtweekend.h"
+#include "utility/simd.h"
+#include "utility/stats.h"
+
+// A SAH-built BVH collapsed so that every node has up to kWidth children,
+// with the children's bounds stored per axis and side (structure of arrays)
+// so that one SIMD slab test checks all of them. Nodes are visited nearest
+// child first, using the entry distances the slab test produces, and a
+// pending child is skipped when a hit closer than its box was found since it
+// was queued.
+//
+// With kMotion, nodes also store how their children's bounds change from
+// time0 to time1, built from Hittable::MotionBounds, and traversal
+// interpolates the boxes to each ray's time instead of testing the boxes
+// swept over the whole interval.
+//
+// Leaves made only of Spheres, or only of MovingSpheres, are intersected
+// kSimdWidth spheres at a time from structure-of-arrays copies of their
+// centers and radii, and only the nearest sphere hit is recorded.
+template <int kWidth, bool kMotion = false>
+class WideBvh : public Hittable {
+ public:
+  WideBvh(HittableList& list, double time0, double time1)
+      : WideBvh(list, time0, time1, DefaultBvhBuildOptions()) {}
+  WideBvh(HittableList& list, double time0, double time1,
+          const BvhBuildOptions& options);
+  // nodes_ may view node_storage_, and a copy or move would go on viewing
+  // the original's, so WideBvhs are neither copied nor moved.
+  WideBvh(const WideBvh&) = delete;
+  WideBvh& operator=(const WideBvh&) = delete;
+  WideBvh(WideBvh&&) = delete;
+  WideBvh& operator=(WideBvh&&) = delete;
+
+  bool FindHit(const Ray& r, double t_min, double t_max,
+               HitRecord* hit_record) const override;
+  bool Occluded(const Ray& r, double t_min, double t_max) const override;
+  bool BoundingBox(double time0, double time1, Aabb* output_box) const override;
+
+  // Bounds arrays hold at least one full SIMD vector, so the slab test never
+  // reads past them; lanes without a child have an inverted, empty box.
+  static constexpr int kLanes = kWidth > kSimdWidth ? kWidth : kSimdWidth;
+  static_assert(kLanes % kSimdWidth == 0);
+  static constexpr int kKeyframes = kMotion ? 2 : 1;
+
+  struct alignas(64) Node {
+    // bounds[0][side][axis][child], side 0 the minimum and 1 the maximum.
+    // For motion, the bounds at time0 and in bounds[1] their change up to
+    // time1; empty lanes do not change, so they stay empty at every time.
+    double bounds[kKeyframes][2][3][kLanes];
+    // Leaf children: index of the first primitive. Interior children: index
+    // of the child node.
+    int32_t child[kWidth];
+    // Number of primitives of leaf children, 0 for interior children.
+    uint32_t count[kWidth];
+  };
+
+  // Nodes in depth-first order, the root first.
+  [[nodiscard]] std::span<const Node> Nodes() const { return nodes_; }
+  // Primitives in leaf order.
+  [[nodiscard]] const std::vector<std::shared_ptr<Hittable>>& Objects() const {
+    return objects_;
+  }
+
+  // Writes the BVH to a cache file at `path` under `key` (see
+  // bvh_cache.h); `list` is the list it was built over. The file is written
+  // next to `path` and renamed into place, so concurrent runs never read a
+  // partial file.
+  bool Save(const std::string& path, uint64_t key,
+            const HittableList& list) const;
+  // Maps the cache file at `path` and returns the BVH over `list` it holds,
+  // with the nodes read in place from the mapping, or null when the file is
+  // missing, truncated, or was written under another key, version or node
+  // layout.
+  static std::shared_ptr<WideBvh> Load(const std::string& path, uint64_t key,
+                                       const HittableList& list);
+
+ private:
+  WideBvh() = default;
+
+  // Deeper ranges become leaves, which bounds the traversal stack.
+  static constexpr int kMaxDepth = 64;
+
+  // Whether `nodes` form a tree that traversal can walk without leaving
+  // them or `primitive_count` primitives: interior children come after
+  // their parent and no deeper than kMaxDepth, leaves stay within the
+  // primitives, and empty lanes have the empty box no ray enters.
+  static bool ValidNodes(std::span<const Node> nodes, size_t primitive_count);
+
+  // A child waiting to be visited, with the distance at which the ray
+  // enters its box.
+  struct StackEntry {
+    int32_t child;
+    uint32_t count;
+    double t;
+  };
+
+  // A ray broadcast to every SIMD lane for the slab tests.
+  struct SimdRay {
+    SimdDouble origin[3];
+    SimdDouble inv_direction[3];
+    int direction_is_negative[3];
+    // Weight of the time1 keyframe at the ray's time.
+    SimdDouble weight;
+  };
+  [[nodiscard]] SimdRay MakeSimdRay(const Ray& r) const;
+
+  // Slab test of every child of `node` against [t_min, t_max]. Returns the
+  // mask of children hit and stores where the ray enters each in `entry`.
+  static unsigned int IntersectChildren(const Node& node, const SimdRay& ray,
+                                        double t_min, double t_max,
+                                        double* entry);
+
+  // Appends the node covering [start, end) and its subtrees to `nodes` and
+  // returns its index, or returns -1 without adding a node when SAH makes
+  // the range a leaf (never for the root). Builds the subtrees on separate
+  // threads while thread_count allows.
+  static int32_t Build(std::vector<BvhBuildObject>& objects, long start,
+                       long end, int depth, const BvhBuildOptions& options,
+                       int thread_count, std::vector<Node>* nodes);
+  // Replaces the bounds of every node and box_ with keyframes from
+  // MotionBounds.
+  void BuildMotionBounds(double time0, double time1);
+  // How the primitives of a leaf are intersected.
+  enum class LeafKind : uint8_t {
+    // A virtual FindHit or Occluded call per primitive.
+    kObjects,
+    // HitSpheres over the sphere arrays.
+    kSpheres,
+    kMovingSpheres,
+    // HitBoxes over the box arrays.
+    kBoxes,
+  };
+
+  // Fills primitive_kind_, leaf_kind_ and the sphere and box arrays from
+  // primitives_ and nodes_.
+  void BuildLeafArrays();
+
+  // Tests the `count` spheres from primitive `first` on with SIMD, at the
+  // ray's time when kMoving. Returns the index of the one with the nearest
+  // root in [t_min, t_max], the last of them on ties as with one FindHit
+  // call after another, and stores that root in `t`; returns -1 when no
+  // sphere is hit.
+  template <bool kMoving>
+  long HitSpheres(const Ray& r, uint32_t first, uint32_t count, double t_min,
+                  double t_max, double* t) const;
+  // Tests the `count` boxes from primitive `first` on with SIMD like
+  // HitSpheres, also storing the face the nearest one is hit on.
+  long HitBoxes(const Ray& r, uint32_t first, uint32_t count, double t_min,
+                double t_max, double* t, int* face) const;
+  // HitSpheres or HitBoxes for the leaf of `kind` starting at `first`.
+  long HitLeaf(LeafKind kind, const Ray& r, uint32_t first, uint32_t count,
+               double t_min, double t_max, double* t, int* face) const {
+    switch (kind) {
+      case LeafKind::kSpheres:
+        return HitSpheres<false>(r, first, count, t_min, t_max, t);
+      case LeafKind::kMovingSpheres:
+        return HitSpheres<true>(r, first, count, t_min, t_max, t);
+      default:
+        return HitBoxes(r, first, count, t_min, t_max, t, face);
+    }
+  }
+  // primitives_[index]->FindHit and ->Occluded, called directly for Spheres,
+  // MovingSpheres and Boxes in leaves that mix them when built with static
+  // dispatch (see material/dispatch.h).
+  bool HitPrimitive(long index, const Ray& r, double t_min, double t_max,
+                    HitRecord* hit_record) const {
+#ifdef RT_ENABLE_STATIC_DISPATCH
+    const auto* primitive = primitives_[index];
+    switch (primitive_kind_[index]) {
+      case LeafKind::kSpheres:
+        return static_cast<const Sphere*>(primitive)->Sphere::FindHit(
+            r, t_min, t_max, hit_record);
+      case LeafKind::kMovingSpheres:
+        return static_cast<const MovingSphere*>(primitive)
+            ->MovingSphere::FindHit(r, t_min, t_max, hit_record);
+      case LeafKind::kBoxes:
+        return static_cast<const Box*>(primitive)->Box::FindHit(
+            r, t_min, t_max, hit_record);
+      case LeafKind::kObjects:
+        break;
+    }
+#endif
+    return primitives_[index]->FindHit(r, t_min, t_max, hit_record);
+  }
+  bool OccludedPrimitive(long index, const Ray& r, double t_min,
+                         double t_max) const {
+#ifdef RT_ENABLE_STATIC_DISPATCH
+    const auto* primitive = primitives_[index];
+    switch (primitive_kind_[index]) {
+      case LeafKind::kSpheres:
+        return static_cast<const Sphere*>(primitive)->Sphere::Occluded(
+            r, t_min, t_max);
+      case LeafKind::kMovingSpheres:
+        return static_cast<const MovingSphere*>(primitive)
+            ->MovingSphere::Occluded(r, t_min, t_max);
+      case LeafKind::kBoxes:
+        return static_cast<const Box*>(primitive)->Box::Occluded(r, t_min,
+                                                                  t_max);
+      case LeafKind::kObjects:
+        break;
+    }
+#endif
+    return primitives_[index]->Occluded(r, t_min, t_max);
+  }
+
+  // Nodes built by this object; empty when they come from mapping_.
+  std::vector<Node> node_storage_;
+  std::shared_ptr<const MappedFile> mapping_;
+  std::span<const Node> nodes_;
+  // Raw pointers in leaf order for traversal; objects_ owns them.
+  std::vector<const Hittable*> primitives_;
+  std::vector<std::shared_ptr<Hittable>> objects_;
+  // The kind of each primitive and of the leaf starting at each primitive,
+  // and the spheres and boxes among the primitives as structure of arrays,
+  // padded by a SIMD vector so that HitSpheres and HitBoxes can load whole
+  // vectors. MovingSpheres store their center at their time0 and their
+  // velocity.
+  std::vector<LeafKind> primitive_kind_;
+  std::vector<LeafKind> leaf_kind_;
+  std::vector<double> sphere_center_[3];
+  std::vector<double> sphere_velocity_[3];
+  std::vector<double> sphere_time0_;
+  std::vector<double> sphere_radius_squared_;
+  std::vector<double> box_min_[3];
+  std::vector<double> box_max_[3];
+  Aabb box_;
+  double time0_{};
+  // Scales the time since time0_ to the weight of the time1 keyframe.
+  double time_scale_{};
+};
+
+using Bvh4 = WideBvh<4>;
+using Bvh8 = WideBvh<8>;
+using MotionBvh4 = WideBvh<4, true>;
+using MotionBvh8 = WideBvh<8, true>;
+
+template <int kWidth, bool kMotion>
+WideBvh<kWidth, kMotion>::WideBvh(HittableList& list, double time0,
+                                  double time1,
+                                  const BvhBuildOptions& options) {
+  RT_STATS_TIME(bvh_build_seconds);
+  auto start = std::chrono::steady_clock::now();
+  auto threads = std::max(options.thread_count, 1);
+  auto objects = MakeBvhBuildObjects(list, time0, time1, threads);
+  if (objects.empty()) {
+    return;
+  }
+  if constexpr (kMotion) {
+    // Split by the boxes in the middle of the interval, which are closer
+    // than the swept boxes to what rays at an average time see.
+    for (auto& object : objects) {
+      Aabb start_box;
+      Aabb end_box;
+      object.object->MotionBounds(time0, time1, &start_box, &end_box);
+      object.box = Aabb(0.5 * (start_box.Minimum() + end_box.Minimum()),
+                        0.5 * (start_box.Maximum() + end_box.Maximum()));
+      object.centroid = 0.5 * (object.box.Minimum() + object.box.Maximum());
+    }
+  }
+  Build(objects, 0, static_cast<long>(objects.size()), 0, options, threads,
+        &node_storage_);
+
+  box_ = objects[0].box;
+  for (const auto& object : objects) {
+    box_ = Aabb::SurroundingBox(box_, object.box);
+    primitives_.push_back(object.object.get());
+    objects_.push_back(object.object);
+  }
+  if constexpr (kMotion) {
+    time0_ = time0;
+    time_scale_ = time1 > time0 ? 1 / (time1 - time0) : 0;
+    BuildMotionBounds(time0, time1);
+  }
+  nodes_ = node_storage_;
+  BuildLeafArrays();
+
+  if (options.report) {
+    auto seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+    long leaves = 0;
+    long sphere_leaves = 0;
+    long box_leaves = 0;
+    for (const auto& node : nodes_) {
+      for (int c = 0; c < kWidth; ++c) {
+        if (node.count[c] > 0) {
+          auto kind = leaf_kind_[node.child[c]];
+          ++leaves;
+          sphere_leaves += kind == LeafKind::kSpheres ||
+                           kind == LeafKind::kMovingSpheres;
+          box_leaves += kind == LeafKind::kBoxes;
+        }
+      }
+    }
+    std::cerr << kWidth << (kMotion ? "-wide motion BVH" : "-wide BVH")
+              << " over " << objects.size() << " objects built in " << seconds
+              << " seconds on " << threads << " threads: " << nodes_.size()
+              << " nodes, " << leaves << " leaves of "
+              << static_cast<double>(objects.size()) / leaves
+              << " objects on average (at most " << options.max_leaf_size
+              << "), " << sphere_leaves << " of them sphere leaves and "
+              << box_leaves << " box leaves" << std::endl;
+  }
+}
+
+template <int kWidth, bool kMotion>
+int32_t WideBvh<kWidth, kMotion>::Build(
+    std::vector<BvhBuildObject>& objects, long start, long end, int depth,
+    const BvhBuildOptions& options, int thread_count,
+    std::vector<Node>* nodes) {
+  // Collapses the binary SAH tree: starting from the two halves of the
+  // range, keep splitting the largest child range that SAH does not make a
+  // leaf until there are kWidth children.
+  struct Range {
+    long start;
+    long end;
+    bool leaf;
+  };
+  auto mid = end - start == 1 ? end
+                              : SahSplit(objects, start, end, options,
+                                         depth > 0, thread_count);
+  std::vector<Range> ranges;
+  if (mid == end) {
+    if (depth > 0) {
+      return -1;
+    }
+    ranges.push_back({start, end, true});
+  } else {
+    ranges.push_back({start, mid, mid - start == 1});
+    ranges.push_back({mid, end, end - mid == 1});
+  }
+  while (static_cast<int>(ranges.size()) < kWidth && depth < kMaxDepth) {
+    auto largest = ranges.end();
+    for (auto it = ranges.begin(); it != ranges.end(); ++it) {
+      if (!it->leaf &&
+          (largest == ranges.end() ||
+           it->end - it->start > largest->end - largest->start)) {
+        largest = it;
+      }
+    }
+    if (largest == ranges.end()) {
+      break;
+    }
+    auto split = SahSplit(objects, largest->start, largest->end, options,
+                          true, thread_count);
+    if (split == largest->end) {
+      largest->leaf = true;
+      continue;
+    }
+    Range right{split, largest->end, largest->end - split == 1};
+    *largest = {largest->start, split, split - largest->start == 1};
+    ranges.push_back(right);
+  }
+
+  auto index = static_cast<int32_t>(nodes->size());
+  nodes->emplace_back();
+  for (int side = 0; side < 2; ++side) {
+    for (int a = 0; a < 3; ++a) {
+      std::fill_n((*nodes)[index].bounds[0][side][a], kLanes,
+                  side == 0 ? infinity : -infinity);
+      if constexpr (kMotion) {
+        std::fill_n((*nodes)[index].bounds[1][side][a], kLanes, 0.0);
+      }
+    }
+  }
+  for (int c = 0; c < kWidth; ++c) {
+    (*nodes)[index].child[c] = -1;
+    (*nodes)[index].count[c] = 0;
+  }
+
+  auto child_count = static_cast<int>(ranges.size());
+  for (int c = 0; c < child_count; ++c) {
+    const auto& range = ranges[c];
+    auto box = objects[range.start].box;
+    for (long i = range.start + 1; i < range.end; ++i) {
+      box = Aabb::SurroundingBox(box, objects[i].box);
+    }
+    for (int a = 0; a < 3; ++a) {
+      (*nodes)[index].bounds[0][0][a][c] = box.Minimum()[a];
+      (*nodes)[index].bounds[0][1][a][c] = box.Maximum()[a];
+    }
+  }
+  // Ranges still unsplit at the depth limit become leaves as well.
+  auto is_leaf = [&](int c) {
+    return ranges[c].leaf || depth + 1 >= kMaxDepth;
+  };
+  auto set_child = [&](int c, int32_t child) {
+    if (child < 0) {
+      (*nodes)[index].child[c] = static_cast<int32_t>(ranges[c].start);
+      (*nodes)[index].count[c] =
+          static_cast<uint32_t>(ranges[c].end - ranges[c].start);
+    } else {
+      (*nodes)[index].child[c] = child;
+    }
+  };
+
+  if (thread_count > 1 && end - start >= options.parallel_min_objects) {
+    // The children are disjoint ranges of objects: build their subtrees
+    // into arrays of their own, sharing the threads, then append them in
+    // order, moving their child indices past the nodes before them. That
+    // gives the nodes of building them one after another.
+    std::vector<std::vector<Node>> subtrees(child_count);
+    std::vector<int32_t> roots(child_count, -1);
+    auto subtree_threads = std::max(thread_count / child_count, 1);
+    ParallelFor(0, child_count, thread_count, [&](int, long first, long last) {
+      for (auto c = static_cast<int>(first); c < last; ++c) {
+        if (!is_leaf(c)) {
+          roots[c] = Build(objects, ranges[c].start, ranges[c].end, depth + 1,
+                           options, subtree_threads, &subtrees[c]);
+        }
+      }
+    });
+    for (int c = 0; c < child_count; ++c) {
+      auto base = static_cast<int32_t>(nodes->size());
+      set_child(c, roots[c] < 0 ? -1 : base + roots[c]);
+      for (auto node : subtrees[c]) {
+        for (int k = 0; k < kWidth; ++k) {
+          if (node.count[k] == 0 && node.child[k] >= 0) {
+            node.child[k] += base;
+          }
+        }
+        nodes->push_back(node);
+      }
+    }
+    return index;
+  }
+
+  for (int c = 0; c < child_count; ++c) {
+    set_child(c, is_leaf(c) ? -1
+                            : Build(objects, ranges[c].start, ranges[c].end,
+                                    depth + 1, options, thread_count, nodes));
+  }
+  return index;
+}
+
+template <int kWidth, bool kMotion>
+void WideBvh<kWidth, kMotion>::BuildMotionBounds(double time0, double time1) {
+  std::vector<std::pair<Aabb, Aabb>> keyframes(primitives_.size());
+  for (size_t i = 0; i < primitives_.size(); ++i) {
+    primitives_[i]->MotionBounds(time0, time1, &keyframes[i].first,
+                                 &keyframes[i].second);
+  }
+  auto surround = [](std::pair<Aabb, Aabb>* a,
+                     const std::pair<Aabb, Aabb>& b) {
+    a->first = Aabb::SurroundingBox(a->first, b.first);
+    a->second = Aabb::SurroundingBox(a->second, b.second);
+  };
+
+  // Children come after their parents, so walking the nodes backwards sees
+  // every child's keyframes before its parent needs them.
+  std::vector<std::pair<Aabb, Aabb>> node_keyframes(node_storage_.size());
+  for (auto index = static_cast<long>(node_storage_.size()) - 1; index >= 0;
+       --index) {
+    auto& node = node_storage_[index];
+    for (int c = 0; c < kWidth && node.child[c] >= 0; ++c) {
+      std::pair<Aabb, Aabb> child;
+      if (node.count[c] > 0) {
+        child = keyframes[node.child[c]];
+        for (uint32_t i = 1; i < node.count[c]; ++i) {
+          surround(&child, keyframes[node.child[c] + i]);
+        }
+      } else {
+        child = node_keyframes[node.child[c]];
+      }
+      if (c == 0) {
+        node_keyframes[index] = child;
+      } else {
+        surround(&node_keyframes[index], child);
+      }
+      for (int a = 0; a < 3; ++a) {
+        node.bounds[0][0][a][c] = child.first.Minimum()[a];
+        node.bounds[0][1][a][c] = child.first.Maximum()[a];
+        node.bounds[1][0][a][c] =
+            child.second.Minimum()[a] - child.first.Minimum()[a];
+        node.bounds[1][1][a][c] =
+            child.second.Maximum()[a] - child.first.Maximum()[a];
+      }
+    }
+  }
+  box_ = Aabb::SurroundingBox(node_keyframes[0].first,
+                              node_keyframes[0].second);
+}
+
+template <int kWidth, bool kMotion>
+bool WideBvh<kWidth, kMotion>::Save(const std::string& path, uint64_t key,
+                                    const HittableList& list) const {
+  std::unordered_map<const Hittable*, uint32_t> list_index;
+  for (size_t i = 0; i < list.objects_.size(); ++i) {
+    list_index.emplace(list.objects_[i].get(), static_cast<uint32_t>(i));
+  }
+  std::vector<uint32_t> primitive_index;
+  primitive_index.reserve(primitives_.size());
+  for (const auto* primitive : primitives_) {
+    auto it = list_index.find(primitive);
+    if (it == list_index.end()) {
+      return false;
+    }
+    primitive_index.push_back(it->second);
+  }
+
+  BvhCacheHeader header{};
+  std::memcpy(header.magic, kBvhCacheMagic, sizeof(header.magic));
+  header.version = kBvhCacheVersion;
+  header.width = kWidth;
+  header.lanes = kLanes;
+  header.motion = kMotion;
+  header.node_size = sizeof(Node);
+  header.key = key;
+  header.node_count = nodes_.size();
+  header.primitive_count = primitive_index.size();
+  // Nodes start at a multiple of their alignment, which the page-aligned
+  // mapping preserves.
+  header.nodes_offset =
+      (sizeof(header) + alignof(Node) - 1) / alignof(Node) * alignof(Node);
+  header.primitives_offset =
+      header.nodes_offset + nodes_.size() * sizeof(Node);
+  for (int a = 0; a < 3; ++a) {
+    header.box[0][a] = box_.Minimum()[a];
+    header.box[1][a] = box_.Maximum()[a];
+  }
+  header.time0 = time0_;
+  header.time_scale = time_scale_;
+
+  std::error_code error;
+  std::filesystem::create_directories(
+      std::filesystem::path(path).parent_path(), error);
+  auto temporary = path + "." + std::to_string(getpid()) + ".tmp";
+  {
+    std::ofstream out(temporary, std::ios::binary);
+    const char padding[alignof(Node)] = {};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(padding,
+              static_cast<std::streamsize>(header.nodes_offset -
+                                           sizeof(header)));
+    out.write(reinterpret_cast<const char*>(nodes_.data()),
+              static_cast<std::streamsize>(nodes_.size_bytes()));
+    out.write(reinterpret_cast<const char*>(primitive_index.data()),
+              static_cast<std::streamsize>(primitive_index.size() *
+                                           sizeof(uint32_t)));
+    if (!out.flush()) {
+      std::filesystem::remove(temporary, error);
+      return false;
+    }
+  }
+  std::filesystem::rename(temporary, path, error);
+  if (error) {
+    std::filesystem::remove(temporary, error);
+    return false;
+  }
+  return true;
+}
+
+template <int kWidth, bool kMotion>
+std::shared_ptr<WideBvh<kWidth, kMotion>> WideBvh<kWidth, kMotion>::Load(
+    const std::string& path, uint64_t key, const HittableList& list) {
+  RT_STATS_TIME(bvh_build_seconds);
+  auto mapping = std::make_shared<const MappedFile>(path);
+  if (mapping->Data() == nullptr ||
+      mapping->Size() < sizeof(BvhCacheHeader)) {
+    return nullptr;
+  }
+  BvhCacheHeader header;
+  std::memcpy(&header, mapping->Data(), sizeof(header));
+  if (std::memcmp(header.magic, kBvhCacheMagic, sizeof(header.magic)) != 0 ||
+      header.version != kBvhCacheVersion || header.width != kWidth ||
+      header.lanes != kLanes || header.motion != kMotion ||
+      header.node_size != sizeof(Node) || header.key != key ||
+      header.node_count == 0 || header.nodes_offset % alignof(Node) != 0 ||
+      header.primitive_count != list.objects_.size()) {
+    return nullptr;
+  }
+  // Checked piecewise so that a corrupt count cannot overflow the sums.
+  auto size = mapping->Size();
+  if (header.nodes_offset > size ||
+      header.node_count > (size - header.nodes_offset) / sizeof(Node) ||
+      header.primitives_offset !=
+          header.nodes_offset + header.node_count * sizeof(Node) ||
+      header.primitive_count >
+          (size - header.primitives_offset) / sizeof(uint32_t)) {
+    return nullptr;
+  }
+
+  std::span<const Node> nodes = {
+      reinterpret_cast<const Node*>(mapping->Data() + header.nodes_offset),
+      header.node_count};
+  if (!ValidNodes(nodes, header.primitive_count)) {
+    return nullptr;
+  }
+
+  std::shared_ptr<WideBvh> bvh(new WideBvh());
+  bvh->nodes_ = nodes;
+  std::vector<uint32_t> primitive_index(header.primitive_count);
+  std::memcpy(primitive_index.data(),
+              mapping->Data() + header.primitives_offset,
+              primitive_index.size() * sizeof(uint32_t));
+  bvh->objects_.reserve(primitive_index.size());
+  bvh->primitives_.reserve(primitive_index.size());
+  for (auto index : primitive_index) {
+    if (index >= list.objects_.size()) {
+      return nullptr;
+    }
+    bvh->objects_.push_back(list.objects_[index]);
+    bvh->primitives_.push_back(list.objects_[index].get());
+  }
+  const auto& box = header.box;
+  bvh->box_ = Aabb(Point3(box[0][0], box[0][1], box[0][2]),
+                   Point3(box[1][0], box[1][1], box[1][2]));
+  bvh->time0_ = header.time0;
+  bvh->time_scale_ = header.time_scale;
+  bvh->mapping_ = std::move(mapping);
+  bvh->BuildLeafArrays();
+  return bvh;
+}
+
+template <int kWidth, bool kMotion>
+bool WideBvh<kWidth, kMotion>::ValidNodes(std::span<const Node> nodes,
+                                          size_t primitive_count) {
+  std::vector<int> depth(nodes.size(), 0);
+  for (size_t index = 0; index < nodes.size(); ++index) {
+    const auto& node = nodes[index];
+    for (int c = 0; c < kWidth; ++c) {
+      auto child = node.child[c];
+      if (node.count[c] > 0) {
+        if (child < 0 || node.count[c] > primitive_count ||
+            static_cast<size_t>(child) > primitive_count - node.count[c]) {
+          return false;
+        }
+      } else if (child >= 0) {
+        // Children after their parent also rules out cycles.
+        if (static_cast<size_t>(child) <= index ||
+            static_cast<size_t>(child) >= nodes.size() ||
+            depth[index] + 1 >= kMaxDepth) {
+          return false;
+        }
+        depth[child] = std::max(depth[child], depth[index] + 1);
+      } else {
+        for (int a = 0; a < 3; ++a) {
+          if (node.bounds[0][0][a][c] != infinity ||
+              node.bounds[0][1][a][c] != -infinity) {
+            return false;
+          }
+          if constexpr (kMotion) {
+            if (node.bounds[1][0][a][c] != 0 || node.bounds[1][1][a][c] != 0) {
+              return false;
+            }
+          }
+        }
+      }
+    }
+  }
+  return true;
+}
+
+template <int kWidth, bool kMotion>
+void WideBvh<kWidth, kMotion>::BuildLeafArrays() {
+  auto size = primitives_.size();
+  for (int a = 0; a < 3; ++a) {
+    sphere_center_[a].assign(size + kSimdWidth, 0.0);
+    sphere_velocity_[a].assign(size + kSimdWidth, 0.0);
+  }
+  sphere_time0_.assign(size + kSimdWidth, 0.0);
+  sphere_radius_squared_.assign(size + kSimdWidth, 0.0);
+  for (int a = 0; a < 3; ++a) {
+    box_min_[a].assign(size + kSimdWidth, 0.0);
+    box_max_[a].assign(size + kSimdWidth, 0.0);
+  }
+  // Exact types only: a subclass could intersect differently.
+  primitive_kind_.assign(size, LeafKind::kObjects);
+  for (size_t i = 0; i < size; ++i) {
+    const auto& type = typeid(*primitives_[i]);
+    if (type == typeid(Sphere)) {
+      const auto* sphere = static_cast<const Sphere*>(primitives_[i]);
+      primitive_kind_[i] = LeafKind::kSpheres;
+      for (int a = 0; a < 3; ++a) {
+        sphere_center_[a][i] = sphere->center_[a];
+      }
+      sphere_radius_squared_[i] = sphere->radius_ * sphere->radius_;
+    } else if (type == typeid(MovingSphere)) {
+      const auto* sphere = static_cast<const MovingSphere*>(primitives_[i]);
+      primitive_kind_[i] = LeafKind::kMovingSpheres;
+      for (int a = 0; a < 3; ++a) {
+        sphere_center_[a][i] = sphere->center0_[a];
+        sphere_velocity_[a][i] = sphere->velocity_[a];
+      }
+      sphere_time0_[i] = sphere->time0_;
+      sphere_radius_squared_[i] = sphere->radius_ * sphere->radius_;
+    } else if (type == typeid(Box)) {
+      const auto* box = static_cast<const Box*>(primitives_[i]);
+      primitive_kind_[i] = LeafKind::kBoxes;
+      for (int a = 0; a < 3; ++a) {
+        box_min_[a][i] = box->box_min_[a];
+        box_max_[a][i] = box->box_max_[a];
+      }
+    }
+  }
+
+  leaf_kind_.assign(size, LeafKind::kObjects);
+  for (const auto& node : nodes_) {
+    for (int c = 0; c < kWidth; ++c) {
+      if (node.count[c] == 0) {
+        continue;
+      }
+      auto first = primitive_kind_.begin() + node.child[c];
+      if (std::all_of(first, first + node.count[c],
+                      [&](LeafKind k) { return k == *first; })) {
+        leaf_kind_[node.child[c]] = *first;
+      }
+    }
+  }
+}
+
+template <int kWidth, bool kMotion>
+template <bool kMoving>
+long WideBvh<kWidth, kMotion>::HitSpheres(const Ray& r, uint32_t first,
+                                          uint32_t count, double t_min,
+                                          double t_max, double* t) const {
+  RT_STATS_ADD(primitive_tests[static_cast<int>(
+                   kMoving ? PrimitiveType::kMovingSphere
+                           : PrimitiveType::kSphere)],
+               count);
+  // The same quadratic as Sphere::FindHit and MovingSphere::FindHit,
+  // evaluated in the same order, so that they find bit-identical roots.
+  auto a = r.Direction().LengthSquared();
+  auto two_a = SimdDouble::Broadcast(2 * a);
+  auto four_a = SimdDouble::Broadcast(4 * a);
+  SimdDouble origin[3];
+  SimdDouble direction[3];
+  for (int axis = 0; axis < 3; ++axis) {
+    origin[axis] = SimdDouble::Broadcast(r.Origin()[axis]);
+    direction[axis] = SimdDouble::Broadcast(r.Direction()[axis]);
+  }
+  auto time = SimdDouble::Broadcast(r.Time());
+  auto lo = SimdDouble::Broadcast(t_min);
+  alignas(64) double roots[kSimdWidth];
+  long nearest = -1;
+
+  for (uint32_t base = 0; base < count; base += kSimdWidth) {
+    auto index = first + base;
+    SimdDouble oc[3];
+    for (int axis = 0; axis < 3; ++axis) {
+      auto center = SimdDouble::Load(sphere_center_[axis].data() + index);
+      if constexpr (kMoving) {
+        center = center +
+                 (time - SimdDouble::Load(sphere_time0_.data() + index)) *
+                     SimdDouble::Load(sphere_velocity_[axis].data() + index);
+      }
+      oc[axis] = origin[axis] - center;
+    }
+    auto b = SimdDouble::Broadcast(2.0) *
+             (oc[0] * direction[0] + oc[1] * direction[1] +
+              oc[2] * direction[2]);
+    auto c = (oc[0] * oc[0] + oc[1] * oc[1] + oc[2] * oc[2]) -
+             SimdDouble::Load(sphere_radius_squared_.data() + index);
+    auto discriminant = b * b - four_a * c;
+    auto sqrt_d = Sqrt(discriminant);
+
+    auto hi = SimdDouble::Broadcast(t_max);
+    auto neg_b = SimdDouble::Broadcast(-1) * b;
+    auto near_root = (neg_b - sqrt_d) / two_a;
+    auto far_root = (neg_b + sqrt_d) / two_a;
+    auto near_ok = (lo <= near_root) & (near_root <= hi);
+    auto far_ok = (lo <= far_root) & (far_root <= hi);
+    auto real_roots = discriminant >= SimdDouble::Broadcast(0);
+    auto hits = (real_roots & (near_ok | far_ok)).Bits();
+    if (count - base < kSimdWidth) {
+      hits &= (1u << (count - base)) - 1;
+    }
+    if (hits == 0) {
+      continue;
+    }
+
+    Select(near_ok, near_root, far_root).Store(roots);
+    for (int lane = 0; lane < kSimdWidth; ++lane) {
+      if (((hits >> lane) & 1) != 0 && roots[lane] <= t_max) {
+        t_max = roots[lane];
+        nearest = index + lane;
+      }
+    }
+  }
+  *t = t_max;
+  return nearest;
+}
+
+template <int kWidth, bool kMotion>
+long WideBvh<kWidth, kMotion>::HitBoxes(const Ray& r, uint32_t first,
+                                        uint32_t count, double t_min,
+                                        double t_max, double* t,
+                                        int* face) const {
+  RT_STATS_ADD(primitive_tests[static_cast<int>(PrimitiveType::kBox)], count);
+  // The slab test of Box::Slabs, with the same divisions and comparisons,
+  // so that it finds bit-identical distances and faces.
+  SimdDouble origin[3];
+  SimdDouble direction[3];
+  for (int axis = 0; axis < 3; ++axis) {
+    origin[axis] = SimdDouble::Broadcast(r.Origin()[axis]);
+    direction[axis] = SimdDouble::Broadcast(r.Direction()[axis]);
+  }
+  auto lo = SimdDouble::Broadcast(t_min);
+  auto hi = SimdDouble::Broadcast(t_max);
+  alignas(64) double distances[kSimdWidth];
+  alignas(64) double faces[kSimdWidth];
+  long nearest = -1;
+
+  for (uint32_t base = 0; base < count; base += kSimdWidth) {
+    auto index = first + base;
+    auto t_near = SimdDouble::Broadcast(-infinity);
+    auto t_far = SimdDouble::Broadcast(infinity);
+    auto near_face = SimdDouble::Broadcast(0);
+    auto far_face = SimdDouble::Broadcast(0);
+    for (int axis = 0; axis < 3; ++axis) {
+      auto t0 = (SimdDouble::Load(box_min_[axis].data() + index) -
+                 origin[axis]) /
+                direction[axis];
+      auto t1 = (SimdDouble::Load(box_max_[axis].data() + index) -
+                 origin[axis]) /
+                direction[axis];
+      auto min_face = SimdDouble::Broadcast(axis);
+      auto max_face = SimdDouble::Broadcast(axis + 3);
+      auto swap = t1 < t0;
+      auto entry = Select(swap, t1, t0);
+      auto exit = Select(swap, t0, t1);
+      auto entry_face = Select(swap, max_face, min_face);
+      auto exit_face = Select(swap, min_face, max_face);
+      auto nearer = t_near < entry;
+      t_near = Select(nearer, entry, t_near);
+      near_face = Select(nearer, entry_face, near_face);
+      auto farther = exit < t_far;
+      t_far = Select(farther, exit, t_far);
+      far_face = Select(farther, exit_face, far_face);
+    }
+    auto near_ok = (lo <= t_near) & (t_near <= hi);
+    auto far_ok = (lo <= t_far) & (t_far <= hi);
+    auto hits = ((t_near <= t_far) & (near_ok | far_ok)).Bits();
+    if (count - base < kSimdWidth) {
+      hits &= (1u << (count - base)) - 1;
+    }
+    if (hits == 0) {
+      continue;
+    }
+
+    Select(near_ok, t_near, t_far).Store(distances);
+    Select(near_ok, near_face, far_face).Store(faces);
+    for (int lane = 0; lane < kSimdWidth; ++lane) {
+      if (((hits >> lane) & 1) != 0 && distances[lane] <= t_max) {
+        t_max = distances[lane];
+        *face = static_cast<int>(faces[lane]);
+        nearest = index + lane;
+      }
+    }
+  }
+  *t = t_max;
+  return nearest;
+}
+
+template <int kWidth, bool kMotion>
+typename WideBvh<kWidth, kMotion>::SimdRay
+WideBvh<kWidth, kMotion>::MakeSimdRay(const Ray& r) const {
+  SimdRay ray;
+  for (int a = 0; a < 3; ++a) {
+    auto inv = 1.0 / r.Direction()[a];
+    ray.origin[a] = SimdDouble::Broadcast(r.Origin()[a]);
+    ray.inv_direction[a] = SimdDouble::Broadcast(inv);
+    ray.direction_is_negative[a] = inv < 0;
+  }
+  if constexpr (kMotion) {
+    ray.weight = SimdDouble::Broadcast((r.Time() - time0_) * time_scale_);
+  }
+  return ray;
+}
+
+template <int kWidth, bool kMotion>
+unsigned int WideBvh<kWidth, kMotion>::IntersectChildren(const Node& node,
+                                                         const SimdRay& ray,
+                                                         double t_min,
+                                                         double t_max,
+                                                         double* entry) {
+  RT_STATS_ADD(bvh_nodes_visited, 1);
+  RT_STATS_ADD(aabb_tests, kWidth);
+
+  // The ray's interval is the second operand of Max and Min, so it wins
+  // over the NaN of a ray starting on a slab plane it is parallel to.
+  unsigned int mask = 0;
+  for (int base = 0; base < kLanes; base += kSimdWidth) {
+    auto near = SimdDouble::Broadcast(t_min);
+    auto far = SimdDouble::Broadcast(t_max);
+    for (int a = 0; a < 3; ++a) {
+      auto near_side = ray.direction_is_negative[a];
+      auto far_side = 1 - near_side;
+      auto near_plane = SimdDouble::Load(node.bounds[0][near_side][a] + base);
+      auto far_plane = SimdDouble::Load(node.bounds[0][far_side][a] + base);
+      if constexpr (kMotion) {
+        near_plane =
+            near_plane +
+            SimdDouble::Load(node.bounds[1][near_side][a] + base) * ray.weight;
+        far_plane =
+            far_plane +
+            SimdDouble::Load(node.bounds[1][far_side][a] + base) * ray.weight;
+      }
+      near = Max((near_plane - ray.origin[a]) * ray.inv_direction[a], near);
+      far = Min((far_plane - ray.origin[a]) * ray.inv_direction[a], far);
+    }
+    mask |= (near < far).Bits() << base;
+    near.Store(entry + base);
+  }
+  return mask & ((1u << kWidth) - 1);
+}
+
+template <int kWidth, bool kMotion>
+bool WideBvh<kWidth, kMotion>::FindHit(const Ray& r, double t_min,
+                                       double t_max,
+                                       HitRecord* hit_record) const {
+  if (nodes_.empty()) {
+    return false;
+  }
+
+  auto ray = MakeSimdRay(r);
+  StackEntry stack[kMaxDepth * (kWidth - 1) + 1];
+  int stack_size = 0;
+  stack[stack_size++] = {0, 0, t_min};
+  bool hit_anything = false;
+  alignas(64) double entry[kLanes];
+
+  while (stack_size > 0) {
+    auto current = stack[--stack_size];
+    if (current.t > t_max) {
+      continue;
+    }
+    if (current.count > 0) {
+      auto kind = leaf_kind_[current.child];
+      if (kind != LeafKind::kObjects) {
+        double t;
+        int face = 0;
+        auto index = HitLeaf(kind, r, current.child, current.count, t_min,
+                             t_max, &t, &face);
+        if (index >= 0) {
+          // What the primitive's own FindHit would record.
+          hit_record->t = t;
+          hit_record->part = face;
+          hit_record->primitive = primitives_[index];
+          hit_anything = true;
+          t_max = t;
+        }
+        continue;
+      }
+      for (uint32_t i = 0; i < current.count; ++i) {
+        if (HitPrimitive(current.child + i, r, t_min, t_max, hit_record)) {
+          hit_anything = true;
+          t_max = hit_record->t;
+        }
+      }
+      continue;
+    }
+
+    const auto& node = nodes_[current.child];
+    auto mask = IntersectChildren(node, ray, t_min, t_max, entry);
+
+    // Push the hit children farthest first, so the nearest is visited next.
+    auto first = stack_size;
+    for (int c = 0; c < kWidth; ++c) {
+      if (((mask >> c) & 1) == 0) {
+        continue;
+      }
+      StackEntry child{node.child[c], node.count[c], entry[c]};
+      auto position = stack_size++;
+      while (position > first && stack[position - 1].t < child.t) {
+        stack[position] = stack[position - 1];
+        --position;
+      }
+      stack[position] = child;
+    }
+  }
+  return hit_anything;
+}
+
+template <int kWidth, bool kMotion>
+bool WideBvh<kWidth, kMotion>::Occluded(const Ray& r, double t_min,
+                                        double t_max) const {
+  if (nodes_.empty()) {
+    return false;
+  }
+
+  // Any blocker will do, so children are visited in lane order and
+  // traversal stops at the first primitive that blocks the ray.
+  auto ray = MakeSimdRay(r);
+  StackEntry stack[kMaxDepth * (kWidth - 1) + 1];
+  int stack_size = 0;
+  stack[stack_size++] = {0, 0, t_min};
+  alignas(64) double entry[kLanes];
+
+  while (stack_size > 0) {
+    auto current = stack[--stack_size];
+    if (current.count > 0) {
+      auto kind = leaf_kind_[current.child];
+      if (kind != LeafKind::kObjects) {
+        double t;
+        int face;
+        if (HitLeaf(kind, r, current.child, current.count, t_min, t_max, &t,
+                    &face) >= 0) {
+          return true;
+        }
+        continue;
+      }
+      for (uint32_t i = 0; i < current.count; ++i) {
+        if (OccludedPrimitive(current.child + i, r, t_min, t_max)) {
+          return true;
+        }
+      }
+      continue;
+    }
+
+    const auto& node = nodes_[current.child];
+    auto mask = IntersectChildren(node, ray, t_min, t_max, entry);
+    for (int c = 0; c < kWidth; ++c) {
+      if (((mask >> c) & 1) != 0) {
+        stack[stack_size++] = {node.child[c], node.count[c], entry[c]};
+      }
+    }
+  }
+  return false;
+}
+
+template <int kWidth, bool kMotion>
+bool WideBvh<kWidth, kMotion>::BoundingBox(double time0, double time1,
+                                           Aabb* output_box) const {
+  *output_box = box_;
+  return !nodes_.empty();
+}
+
+#pragma endregion  // RAY_TRACING_ONE_WEEK_WIDE_BVH_H
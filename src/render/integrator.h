@@ -0,0 +1,83 @@
+#pragma once
+
+#include "object/hittable.h"
+#include "utility/rtweekend.h"
+
+// Paths start facing Russian roulette once they have made this many bounces;
+// the first few bounces carry most of the image's energy and are always
+// traced.
+const int kRouletteStartDepth = 3;
+// Upper bound on the survival probability, so that even paths through white
+// surfaces terminate well before max_depth.
+const double kRouletteMaxSurvival = 0.95;
+
+// A path in flight: the ray to trace next, the product of the attenuations
+// seen so far (the throughput) and the radiance gathered so far.
+struct PathState {
+  Ray ray;
+  Color throughput{1, 1, 1};
+  Color radiance{0, 0, 0};
+  int depth{};
+};
+
+// Adds the light emitted at the hit to the path and scatters it into its
+// next ray. After kRouletteStartDepth bounces a path survives with a
+// probability equal to its largest throughput channel, and survivors are
+// reweighted by the inverse of that probability, which keeps the estimate
+// unbiased while dropping paths that could contribute little. Returns false
+// when the path ends here. Shared by the depth-first and wavefront
+// integrators so both draw the same random numbers for the same path.
+bool ScatterPath(const HitRecord& hit_record, Sampler* sampler,
+                 PathState* path) {
+  const auto& material = DefaultMaterialTable()[hit_record.material];
+  AddEmitted(material, hit_record, path->throughput, &path->radiance);
+
+  RT_STATS_ADD(scatters[static_cast<int>(material.Type())], 1);
+  Ray scattered;
+  Color attenuation;
+  if (!MaterialScatter(material, path->ray, hit_record, &attenuation,
+                       &scattered, sampler)) {
+    return false;
+  }
+  path->throughput = path->throughput * attenuation;
+
+  if (path->depth + 1 >= kRouletteStartDepth) {
+    auto survival = fmin(fmax(path->throughput.X(),
+                              fmax(path->throughput.Y(), path->throughput.Z())),
+                         kRouletteMaxSurvival);
+    if (sampler->Next() >= survival) {
+      return false;
+    }
+    path->throughput /= survival;
+  }
+
+  path->ray = scattered;
+  return true;
+}
+
+// Traces the path starting with ray r and returns the radiance it carries
+// back to the camera. The path is followed iteratively, so the stack stays
+// flat whatever max_depth is.
+Color RayColor(const Ray& r, const Color& background, const Hittable& world,
+               int max_depth, Sampler* sampler) {
+  PathState path{r};
+  HitRecord hit_record;
+
+  for (; path.depth < max_depth; ++path.depth) {
+    sampler->SetBounce(path.depth);
+    RT_STATS_RAY(path.depth);
+
+    // If the ray hits nothing, return the background color.
+    if (!world.Hit(path.ray, 0.001, infinity, &hit_record)) {
+      return path.radiance + path.throughput * background;
+    }
+    if (!ScatterPath(hit_record, sampler, &path)) {
+      return path.radiance;
+    }
+  }
+
+  // If we've exceeded the ray bounce limit, no more light is gathered.
+  return path.radiance;
+}
+
+#pragma endregion  // RAY_TRACING_ONE_WEEK_INTEGRATOR_H
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "utility/rtweekend.h"
+
+// Running estimate of a pixel: the sum of its samples for the final color and
+// Welford's mean/variance of their luminance for the convergence test.
+struct PixelEstimate {
+  Color sum;
+  double mean{};
+  double m2{};
+  int count{};
+
+  void Add(const Color& sample) {
+    sum += sample;
+    ++count;
+    auto luminance =
+        0.2126 * sample.X() + 0.7152 * sample.Y() + 0.0722 * sample.Z();
+    auto delta = luminance - mean;
+    mean += delta / count;
+    m2 += delta * (luminance - mean);
+  }
+
+  // Standard error of the pixel as it will be displayed, i.e. after the
+  // gamma 2 curve and the clamp to 1 applied by write_color.
+  [[nodiscard]] double DisplayError() const {
+    if (count < 2) {
+      return infinity;
+    }
+    auto standard_error = sqrt(m2 / (count - 1) / count);
+    if (mean - 3 * standard_error > 1) {
+      // Saturated: every plausible value is displayed as white.
+      return 0;
+    }
+    // d(sqrt(L)) = dL / (2 sqrt(L)); the floor keeps near-black pixels from
+    // demanding an unbounded number of samples.
+    return standard_error / (2 * sqrt(fmax(mean, 1e-4)));
+  }
+};
+
+// A request for `count` more samples of pixel (i, j), accumulated into
+// `estimate`. Sample indices continue from estimate->count.
+struct SampleRequest {
+  int i;
+  int j;
+  int count;
+  PixelEstimate* estimate;
+};
+
+#pragma endregion  // RAY_TRACING_ONE_WEEK_PIXEL_ESTIMATE_H
@@ -0,0 +1,28 @@
+#pragma once
+
+// Image and sampling parameters shared by every render thread.
+struct RenderSettings {
+  int image_width;
+  int image_height;
+  int max_depth;
+  int samples_per_pixel;
+
+  // Adaptive sampling is enabled when the threshold is positive. A pixel
+  // stops taking samples once the standard error of its displayed value
+  // drops below the threshold; the samples it did not use stay in its tile's
+  // budget of samples_per_pixel * tile pixels and go to the noisier pixels,
+  // each of which may take up to adaptive_max_samples.
+  double adaptive_threshold{};
+  int adaptive_min_samples{16};
+  int adaptive_max_samples{};
+
+  // Trace samples with the WavefrontIntegrator, wavefront_batch_size paths at
+  // a time, instead of one path after another.
+  bool wavefront{};
+  int wavefront_batch_size{16384};
+  // Let the wavefront integrator trace camera rays and first bounces as SIMD
+  // packets of kPacketSize rays instead of one ray at a time.
+  bool packets{};
+};
+
+#pragma endregion  // RAY_TRACING_ONE_WEEK_RENDER_SETTINGS_H
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <algorithm>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A rectangular block of pixels, [x0, x1) x [y0, y1).
+struct Tile {
+  int x0;
+  int y0;
+  int x1;
+  int y1;
+};
+
+// Splits the image into tiles and renders them on a pool of threads. Every
+// thread owns a deque of tiles: it pops work from the front of its own deque
+// and, once that runs dry, steals from the back of another thread's deque, so
+// a thread that drew cheap tiles (sky) keeps helping the ones that drew
+// expensive tiles (glass, smoke) instead of going idle.
+class TileScheduler {
+ public:
+  TileScheduler(int image_width, int image_height, int tile_size,
+                int thread_count);
+
+  // Calls render_tile(tile, thread_index) once for every tile of the image and
+  // returns when all of them are done. The calling thread is worker 0.
+  template <typename RenderTile>
+  void Run(RenderTile&& render_tile);
+
+  [[nodiscard]] int ThreadCount() const { return thread_count_; }
+  [[nodiscard]] int TileCount() const { return tile_count_; }
+
+ private:
+  // Padded to a cache line so that threads locking their own queue do not
+  // invalidate their neighbours' queues.
+  struct alignas(64) WorkQueue {
+    std::mutex mutex;
+    std::deque<Tile> tiles;
+  };
+
+  bool Pop(int thread_index, Tile* tile);
+  bool Steal(int thread_index, Tile* tile);
+  void ReportProgress();
+
+  int thread_count_;
+  int tile_count_{};
+  std::unique_ptr<WorkQueue[]> queues_;
+  int tiles_remaining_{};
+  std::mutex progress_mutex_;
+};
+
+TileScheduler::TileScheduler(int image_width, int image_height, int tile_size,
+                             int thread_count)
+    : thread_count_(std::max(thread_count, 1)),
+      queues_(new WorkQueue[std::max(thread_count, 1)]) {
+  tile_size = std::max(tile_size, 1);
+
+  // Tiles are generated top to bottom, matching the order of the old
+  // scanline loop, and dealt out in contiguous runs so that each thread
+  // starts on neighbouring tiles that share texture and BVH working sets.
+  std::vector<Tile> tiles;
+  for (int y1 = image_height; y1 > 0; y1 -= tile_size) {
+    for (int x0 = 0; x0 < image_width; x0 += tile_size) {
+      tiles.push_back({x0, std::max(y1 - tile_size, 0),
+                       std::min(x0 + tile_size, image_width), y1});
+    }
+  }
+  tile_count_ = static_cast<int>(tiles.size());
+  tiles_remaining_ = tile_count_;
+
+  auto per_thread = (tile_count_ + thread_count_ - 1) / thread_count_;
+  for (int i = 0; i < tile_count_; ++i) {
+    queues_[i / per_thread].tiles.push_back(tiles[i]);
+  }
+}
+
+template <typename RenderTile>
+void TileScheduler::Run(RenderTile&& render_tile) {
+  auto worker = [this, &render_tile](int thread_index) {
+    Tile tile{};
+    while (Pop(thread_index, &tile) || Steal(thread_index, &tile)) {
+      render_tile(tile, thread_index);
+      ReportProgress();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(thread_count_ - 1);
+  for (int i = 1; i < thread_count_; ++i) {
+    threads.emplace_back(worker, i);
+  }
+  worker(0);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+bool TileScheduler::Pop(int thread_index, Tile* tile) {
+  auto& queue = queues_[thread_index];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if (queue.tiles.empty()) {
+    return false;
+  }
+  *tile = queue.tiles.front();
+  queue.tiles.pop_front();
+  return true;
+}
+
+bool TileScheduler::Steal(int thread_index, Tile* tile) {
+  // Tiles are never added after construction, so a single sweep over the
+  // other queues that finds them all empty means the image is done.
+  for (int offset = 1; offset < thread_count_; ++offset) {
+    auto& victim = queues_[(thread_index + offset) % thread_count_];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tiles.empty()) {
+      *tile = victim.tiles.back();
+      victim.tiles.pop_back();
+      return true;
+    }
+  }
+  return false;
+}
+
+void TileScheduler::ReportProgress() {
+  std::lock_guard<std::mutex> lock(progress_mutex_);
+  std::cerr << "\rTiles remaining: " << --tiles_remaining_ << "    "
+            << std::flush;
+}
+
+#pragma endregion  // RAY_TRACING_ONE_WEEK_TILE_SCHEDULER_H
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include "object/camera.h"
+#include "object/hittable.h"
+#include "render/integrator.h"
+#include "render/pixel_estimate.h"
+#include "render/render_settings.h"
+
+// Bounces traced as packets when RenderSettings::packets is set: the camera
+// rays and the first bounce. Deeper bounces are too incoherent to benefit.
+const int kPacketMaxDepth = 2;
+
+// Stream (wavefront) path tracer. Instead of following one path from the
+// camera to its end before starting the next, it generates a batch of camera
+// paths and advances the whole batch one bounce at a time through separate
+// stages:
+//
+//   Extend: intersect every active path with the scene; with packets enabled,
+//           camera rays and first bounces are intersected kPacketSize at a
+//           time (after the first shading pass, diffuse bounces sit next to
+//           each other in the active list).
+//   Sort:   bucket the hits by material kind.
+//   Shade:  emit, scatter and apply Russian roulette one bucket at a time,
+//           so consecutive Scatter calls go to the same implementation.
+//
+// Each path owns its Sampler and the stages call the same ScatterPath as the
+// depth-first RayColor, so both integrators produce identical images.
+class WavefrontIntegrator {
+ public:
+  WavefrontIntegrator(const Hittable& world, const Camera& camera,
+                      const RenderSettings& settings)
+      : world_(world),
+        camera_(camera),
+        settings_(settings),
+        batch_size_(std::max(settings.wavefront_batch_size, 1)) {
+    paths_.reserve(batch_size_);
+    hits_.resize(batch_size_);
+    active_.reserve(batch_size_);
+  }
+
+  // Takes every requested sample and adds them, in request order, to the
+  // requests' estimates.
+  void Trace(const std::vector<SampleRequest>& requests);
+
+ private:
+  struct WavefrontPath {
+    PathState state;
+    Sampler sampler;
+    int request;
+  };
+
+  void Generate(const SampleRequest& request, int request_index, int sample);
+  void Extend(int depth);
+  void ExtendPackets(int depth);
+  void SortByMaterial();
+  void Shade();
+
+  const Hittable& world_;
+  const Camera& camera_;
+  const RenderSettings& settings_;
+  int batch_size_;
+
+  // paths_ never grows past batch_size_, so the Sampler pointers stored in
+  // the paths' rays stay valid for the whole batch.
+  std::vector<WavefrontPath> paths_;
+  std::vector<HitRecord> hits_;
+  std::vector<int> active_;
+  std::array<std::vector<int>, kMaterialTypeCount> queues_;
+  std::vector<int> first_samples_;
+};
+
+void WavefrontIntegrator::Trace(const std::vector<SampleRequest>& requests) {
+  // Estimates are only updated after each batch, so remember where every
+  // request's sample indices start.
+  first_samples_.clear();
+  for (const auto& request : requests) {
+    first_samples_.push_back(request.estimate->count);
+  }
+
+  int request_index = 0;
+  int sample = 0;
+  auto request_count = static_cast<int>(requests.size());
+  while (request_index < request_count) {
+    paths_.clear();
+    while (static_cast<int>(paths_.size()) < batch_size_ &&
+           request_index < request_count) {
+      if (sample < requests[request_index].count) {
+        Generate(requests[request_index], request_index,
+                 first_samples_[request_index] + sample++);
+      } else {
+        ++request_index;
+        sample = 0;
+      }
+    }
+
+    active_.clear();
+    for (int index = 0; index < static_cast<int>(paths_.size()); ++index) {
+      active_.push_back(index);
+    }
+    for (int depth = 0; !active_.empty(); ++depth) {
+      Extend(depth);
+      SortByMaterial();
+      Shade();
+    }
+
+    for (const auto& path : paths_) {
+      requests[path.request].estimate->Add(path.state.radiance);
+    }
+  }
+}
+
+void WavefrontIntegrator::Generate(const SampleRequest& request,
+                                   int request_index, int sample) {
+  auto& path = paths_.emplace_back();
+  path.request = request_index;
+  path.sampler = Sampler(request.j * settings_.image_width + request.i, sample);
+
+  auto u = (request.i + path.sampler.Next()) / (settings_.image_width - 1);
+  auto v = (request.j + path.sampler.Next()) / (settings_.image_height - 1);
+  path.state.ray = camera_.GetRay(u, v, &path.sampler);
+}
+
+void WavefrontIntegrator::Extend(int depth) {
+  if (settings_.packets && depth < kPacketMaxDepth) {
+    ExtendPackets(depth);
+    return;
+  }
+
+  size_t kept = 0;
+  for (auto index : active_) {
+    auto& path = paths_[index];
+    path.sampler.SetBounce(path.state.depth);
+    RT_STATS_RAY(path.state.depth);
+    if (world_.Hit(path.state.ray, 0.001, infinity, &hits_[index])) {
+      active_[kept++] = index;
+    } else {
+      path.state.radiance += path.state.throughput * camera_.background_;
+    }
+  }
+  active_.resize(kept);
+}
+
+void WavefrontIntegrator::ExtendPackets(int depth) {
+  RayPacket packet;
+  PacketHit hit;
+  size_t kept = 0;
+
+  for (size_t first = 0; first < active_.size(); first += kPacketSize) {
+    auto count = std::min<size_t>(kPacketSize, active_.size() - first);
+    packet.size = 0;
+    hit.mask = 0;
+    for (size_t k = 0; k < count; ++k) {
+      auto& path = paths_[active_[first + k]];
+      path.sampler.SetBounce(depth);
+      RT_STATS_RAY(depth);
+      packet.Add(path.state.ray);
+      hit.t_max[k] = infinity;
+    }
+    packet.Pad();
+
+    world_.HitPacket(packet, packet.ActiveMask(), 0.001, &hit);
+
+    for (size_t k = 0; k < count; ++k) {
+      auto index = active_[first + k];
+      auto& path = paths_[index];
+      if (((hit.mask >> k) & 1) != 0) {
+        hits_[index] = hit.records[k];
+        hits_[index].primitive->CompleteHit(path.state.ray, &hits_[index]);
+        active_[kept++] = index;
+      } else {
+        path.state.radiance += path.state.throughput * camera_.background_;
+      }
+    }
+  }
+  active_.resize(kept);
+}
+
+void WavefrontIntegrator::SortByMaterial() {
+  for (auto& queue : queues_) {
+    queue.clear();
+  }
+  const auto& materials = DefaultMaterialTable();
+  for (auto index : active_) {
+    auto type = static_cast<int>(materials[hits_[index].material].Type());
+    queues_[type].push_back(index);
+  }
+}
+
+void WavefrontIntegrator::Shade() {
+  active_.clear();
+  for (const auto& queue : queues_) {
+    for (auto index : queue) {
+      auto& path = paths_[index];
+      if (ScatterPath(hits_[index], &path.sampler, &path.state) &&
+          ++path.state.depth < settings_.max_depth) {
+        active_.push_back(index);
+      }
+    }
+  }
+}
+
+#pragma endregion  // RAY_TRACING_ONE_WEEK_WAVEFRONT_H
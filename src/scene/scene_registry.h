@@ -0,0 +1,85 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "object/camera.h"
+#include "object/hittable_list.h"
+#include "scene/scenes.h"
+
+// Builds a scene's objects and camera from the default camera.
+using SceneFactory =
+    std::function<HittableList(const std::shared_ptr<Camera>& camera)>;
+
+// Named scene factories. Scenes are only constructed when requested, so
+// starting a render of a small scene does not pay for building the others.
+class SceneRegistry {
+ public:
+  void Register(std::string name, SceneFactory factory) {
+    scenes_.emplace_back(std::move(name), std::move(factory));
+  }
+
+  [[nodiscard]] bool Contains(const std::string& name) const {
+    return Find(name) != nullptr;
+  }
+
+  // Builds the named scene; the name must be registered.
+  [[nodiscard]] HittableList Build(
+      const std::string& name, const std::shared_ptr<Camera>& camera) const {
+    return (*Find(name))(camera);
+  }
+
+  // Scene names in registration order.
+  [[nodiscard]] std::vector<std::string> Names() const {
+    std::vector<std::string> names;
+    for (const auto& scene : scenes_) {
+      names.push_back(scene.first);
+    }
+    return names;
+  }
+
+ private:
+  [[nodiscard]] const SceneFactory* Find(const std::string& name) const {
+    for (const auto& scene : scenes_) {
+      if (scene.first == name) {
+        return &scene.second;
+      }
+    }
+    return nullptr;
+  }
+
+  std::vector<std::pair<std::string, SceneFactory>> scenes_;
+};
+
+// The built-in scenes.
+const SceneRegistry& DefaultSceneRegistry() {
+  static const SceneRegistry registry = [] {
+    SceneRegistry scenes;
+    scenes.Register("Random", [](const std::shared_ptr<Camera>& camera) {
+      return RandomScene(camera, false, false);
+    });
+    scenes.Register("WithTime", [](const std::shared_ptr<Camera>& camera) {
+      return RandomScene(camera, true, false);
+    });
+    scenes.Register("CheckerTexture",
+                    [](const std::shared_ptr<Camera>& camera) {
+                      return RandomScene(camera, true, true);
+                    });
+    scenes.Register("TwoSpheres", TwoSpheres);
+    scenes.Register("TwoPerlinSpheres", TwoPerlinSpheres);
+    scenes.Register("Earth", Earth);
+    scenes.Register("SampleLight", SampleLight);
+    scenes.Register("CornellBox", CornellBox);
+    scenes.Register("CornellSmoke", CornellSmoke);
+    scenes.Register("TheNextWeek", TheNextWeek);
+    scenes.Register("Instances", Instances);
+    scenes.Register("Meshes", Meshes);
+    return scenes;
+  }();
+  return registry;
+}
+
+#pragma endregion  // RAY_TRACING_ONE_WEEK_SCENE_REGISTRY_H
@@ -0,0 +1,431 @@
+#pragma once
+
+#include <memory>
+#include <utility>
+
+#include "material/diffuse_light.h"
+#include "material/solid_color.h"
+#include "material/texture/checker_texture.h"
+#include "material/texture/image_texture.h"
+#include "material/texture/noise_texture.h"
+#include "object/aa_rectangle.h"
+#include "object/box.h"
+#include "object/bvh.h"
+#include "object/bvh_factory.h"
+#include "object/camera.h"
+#include "object/constant_medium.h"
+#include "object/hittable_list.h"
+#include "object/instance.h"
+#include "object/mesh_loader.h"
+#include "object/moving_sphere.h"
+#include "object/sphere.h"
+#include "object/triangle_mesh.h"
+#include "utility/rtweekend.h"
+#include "utility/transform.h"
+
+// Every scene takes the default camera and returns its objects together with
+// the camera to render them from, derived from the default one.
+
+HittableList RandomScene(shared_ptr<Camera> camera, bool has_time = true,
+                         bool has_checker_texture = true) {
+  HittableList boxes;
+  HittableList world;
+
+  double time0 = 0.0f;
+  double time1 = 1.0f;
+  if (!has_time) {
+    time0 = 0.0f;
+    time1 = 0.0f;
+  }
+
+  if (has_checker_texture) {
+    auto checker =
+        make_shared<CheckTexture>(make_shared<SolidColor>(0.2f, 0.3f, 0.1f),
+                                  make_shared<SolidColor>(0.9f, 0.9f, 0.9f));
+    boxes.Add(make_shared<Sphere>(Point3(0, -1000, 0), 1000,
+                                  make_shared<Lambertian>(checker)));
+  } else {
+    auto ground_material = make_shared<Lambertian>(Color(0.5, 0.5, 0.5));
+    boxes.Add(make_shared<Sphere>(Point3(0, -1000, 0), 1000, ground_material));
+  }
+
+  for (int a = -11; a < 11; a++) {
+    for (int b = -11; b < 11; b++) {
+      auto choose_mat = RandomDouble();
+      Point3 center(a + 0.9 * RandomDouble(), 0.2, b + 0.9 * RandomDouble());
+
+      if ((center - Point3(4, 0.2, 0)).Length() > 0.9) {
+        shared_ptr<Material> sphere_material;
+
+        if (choose_mat < 0.8) {
+          // diffuse
+          auto albedo = Color::Random() * Color::Random();
+          sphere_material = make_shared<Lambertian>(albedo);
+          auto center2 = center + Vec3(0, RandomDouble(0, 0.5), 0);
+          boxes.Add(make_shared<MovingSphere>(center, center2, time0, time1,
+                                              0.2, sphere_material));
+        } else if (choose_mat < 0.95) {
+          // metal
+          auto albedo = Color::Random(0.5, 1);
+          auto fuzz = RandomDouble(0, 0.5);
+          sphere_material = make_shared<Metal>(albedo, fuzz);
+          boxes.Add(make_shared<Sphere>(center, 0.2, sphere_material));
+        } else {
+          // glass
+          sphere_material = make_shared<Dielectric>(1.5);
+          boxes.Add(make_shared<Sphere>(center, 0.2, sphere_material));
+        }
+      }
+    }
+  }
+
+  auto material1 = make_shared<Dielectric>(1.5);
+  boxes.Add(make_shared<Sphere>(Point3(0, 1, 0), 1.0, material1));
+
+  auto material2 = make_shared<Lambertian>(Color(0.4, 0.2, 0.1));
+  boxes.Add(make_shared<Sphere>(Point3(-4, 1, 0), 1.0, material2));
+
+  auto material3 = make_shared<Metal>(Color(0.7, 0.6, 0.5), 0.0);
+  boxes.Add(make_shared<Sphere>(Point3(4, 1, 0), 1.0, material3));
+
+  world.Add(MakeBvh(boxes, 0, 1));
+
+  world.camera_ = std::move(camera);
+  return world;
+}
+
+HittableList TwoSpheres(shared_ptr<Camera> camera) {
+  HittableList objects;
+
+  auto checker =
+      make_shared<CheckTexture>(make_shared<SolidColor>(0.2f, 0.3f, 0.1f),
+                                make_shared<SolidColor>(0.9f, 0.9f, 0.9f));
+  objects.Add(make_shared<Sphere>(Point3(0, -10, 0), 10,
+                                  make_shared<Lambertian>(checker)));
+  objects.Add(make_shared<Sphere>(Point3(0, 10, 0), 10,
+                                  make_shared<Lambertian>(checker)));
+
+  objects.camera_ = std::move(camera);
+
+  return objects;
+}
+
+HittableList TwoPerlinSpheres(shared_ptr<Camera> camera) {
+  HittableList objects;
+
+  auto per_text = make_shared<NoiseTexture>(4);
+  objects.Add(make_shared<Sphere>(Point3(0, -1000, 0), 1000,
+                                  make_shared<Lambertian>(per_text)));
+  objects.Add(make_shared<Sphere>(Point3(0, 2, 0), 2,
+                                  make_shared<Lambertian>(per_text)));
+
+  objects.camera_ = std::move(camera);
+  return objects;
+}
+
+HittableList Earth(shared_ptr<Camera> camera) {
+  auto earth_texture = make_shared<ImageTexture>("resources/earth-map.jpg");
+  auto earth_surface = make_shared<Lambertian>(earth_texture);
+  auto globe = make_shared<Sphere>(Point3(0, 0, 0), 2, earth_surface);
+  auto world = HittableList(globe);
+
+  world.camera_ = std::move(camera);
+
+  return world;
+}
+
+HittableList SampleLight(const std::shared_ptr<Camera>& camera) {
+  HittableList objects;
+  auto per_text = make_shared<NoiseTexture>(4);
+  objects.Add(make_shared<Sphere>(Point3(0, -1000, 0), 1000,
+                                  make_shared<Lambertian>(per_text)));
+  objects.Add(make_shared<Sphere>(Point3(0, 2, 0), 2,
+                                  make_shared<Lambertian>(per_text)));
+
+  auto diff_light = make_shared<DiffuseLight>(make_shared<SolidColor>(4, 4, 4));
+  objects.Add(make_shared<Sphere>(Point3(0, 7, 0), 2, diff_light));
+  objects.Add(make_shared<XyRectangle>(3, 5, 1, 3, -2, diff_light));
+
+  Point3 look_from(26.0, 3.0, 6.0);
+  Point3 look_at(0, 2, 0);
+  auto aperture = 0.01;
+
+  objects.camera_ =
+      make_shared<Camera>(look_from, look_at, camera->v_up_, camera->v_fov_,
+                          camera->aspect_ratio_, aperture, camera->focus_dist_);
+
+  return objects;
+}
+
+HittableList CornellBox(const std::shared_ptr<Camera>& camera) {
+  HittableList objects;
+
+  auto red = std::make_shared<Lambertian>(Color(0.65, 0.05, 0.05));
+  auto white = std::make_shared<Lambertian>(Color(0.73, 0.73, 0.73));
+  auto green = std::make_shared<Lambertian>(Color(.12, .45, .15));
+  auto light = std::make_shared<DiffuseLight>(Color(15, 15, 15));
+
+  objects.Add(std::make_shared<YzRectangle>(0, 555, 0, 555, 555, green));
+  objects.Add(std::make_shared<YzRectangle>(0, 555, 0, 555, 0, red));
+  objects.Add(std::make_shared<XzRectangle>(213, 343, 227, 332, 554, light));
+  objects.Add(std::make_shared<XzRectangle>(0, 555, 0, 555, 0, white));
+  objects.Add(std::make_shared<XzRectangle>(0, 555, 0, 555, 555, white));
+  objects.Add(std::make_shared<XyRectangle>(0, 555, 0, 555, 555, white));
+
+  auto box1 = std::make_shared<Instance>(
+      std::make_shared<Box>(Point3(0, 0, 0), Point3(165, 330, 165), white),
+      Transform::Translation(Vec3(265, 0, 295)) * Transform::RotationY(15));
+  objects.Add(box1);
+
+  auto box2 = std::make_shared<Instance>(
+      std::make_shared<Box>(Point3(0, 0, 0), Point3(165, 165, 165), white),
+      Transform::Translation(Vec3(130, 0, 65)) * Transform::RotationY(-18));
+  objects.Add(box2);
+
+  objects.camera_ = std::make_shared<Camera>(
+      Point3(278, 278, -800), Point3(278, 278, 0), camera->v_up_, 40, 1.0,
+      camera->aperture_, camera->focus_dist_, Color(0, 0, 0), 0, 0);
+
+  return objects;
+}
+
+HittableList CornellSmoke(const std::shared_ptr<Camera>& camera) {
+  HittableList objects;
+
+  auto red = std::make_shared<Lambertian>(Color(0.65, 0.05, 0.05));
+  auto white = std::make_shared<Lambertian>(Color(0.73, 0.73, 0.73));
+  auto green = std::make_shared<Lambertian>(Color(.12, .45, .15));
+  auto light = std::make_shared<DiffuseLight>(Color(7, 7, 7));
+
+  objects.Add(std::make_shared<YzRectangle>(0, 555, 0, 555, 555, green));
+  objects.Add(std::make_shared<YzRectangle>(0, 555, 0, 555, 0, red));
+  objects.Add(std::make_shared<XzRectangle>(113, 443, 127, 432, 554, light));
+  objects.Add(std::make_shared<XzRectangle>(0, 555, 0, 555, 0, white));
+  objects.Add(std::make_shared<XzRectangle>(0, 555, 0, 555, 555, white));
+  objects.Add(std::make_shared<XyRectangle>(0, 555, 0, 555, 555, white));
+
+  auto box1 = std::make_shared<Instance>(
+      std::make_shared<Box>(Point3(0, 0, 0), Point3(165, 330, 165), white),
+      Transform::Translation(Vec3(265, 0, 295)) * Transform::RotationY(15));
+
+  auto box2 = std::make_shared<Instance>(
+      std::make_shared<Box>(Point3(0, 0, 0), Point3(165, 165, 165), white),
+      Transform::Translation(Vec3(130, 0, 65)) * Transform::RotationY(-18));
+
+  objects.Add(make_shared<ConstantMedium>(box1, 0.01, Color(0, 0, 0)));
+  objects.Add(make_shared<ConstantMedium>(box2, 0.01, Color(1, 1, 1)));
+
+  objects.camera_ = std::make_shared<Camera>(
+      Point3(278, 278, -800), Point3(278, 278, 0), camera->v_up_, 40, 1.0,
+      camera->aperture_, camera->focus_dist_, Color(0, 0, 0), 0, 0);
+
+  return objects;
+}
+
+HittableList TheNextWeek(const std::shared_ptr<Camera>& camera) {
+  HittableList boxes1;
+  auto ground = make_shared<Lambertian>(Color(0.48, 0.83, 0.53));
+
+  const int boxes_per_side = 20;
+  for (int i = 0; i < boxes_per_side; i++) {
+    for (int j = 0; j < boxes_per_side; j++) {
+      auto w = 100.0;
+      auto x0 = -1000.0 + i * w;
+      auto z0 = -1000.0 + j * w;
+      auto y0 = 0.0;
+      auto x1 = x0 + w;
+      auto y1 = RandomDouble(1, 101);
+      auto z1 = z0 + w;
+
+      boxes1.Add(
+          make_shared<Box>(Point3(x0, y0, z0), Point3(x1, y1, z1), ground));
+    }
+  }
+
+  HittableList objects;
+
+  objects.Add(MakeBvh(boxes1, 0, 1));
+
+  auto light = make_shared<DiffuseLight>(Color(7, 7, 7));
+  objects.Add(make_shared<XzRectangle>(123, 423, 147, 412, 554, light));
+
+  auto center1 = Point3(400, 400, 200);
+  auto center2 = center1 + Vec3(30, 0, 0);
+  auto moving_sphere_material = make_shared<Lambertian>(Color(0.7, 0.3, 0.1));
+  objects.Add(make_shared<MovingSphere>(center1, center2, 0, 1, 50,
+                                        moving_sphere_material));
+
+  objects.Add(make_shared<Sphere>(Point3(260, 150, 45), 50,
+                                  make_shared<Dielectric>(1.5)));
+  objects.Add(make_shared<Sphere>(
+      Point3(0, 150, 145), 50, make_shared<Metal>(Color(0.8, 0.8, 0.9), 1.0)));
+
+  auto boundary = make_shared<Sphere>(Point3(360, 150, 145), 70,
+                                      make_shared<Dielectric>(1.5));
+  objects.Add(boundary);
+  objects.Add(make_shared<ConstantMedium>(boundary, 0.2, Color(0.2, 0.4, 0.9)));
+  boundary =
+      make_shared<Sphere>(Point3(0, 0, 0), 5000, make_shared<Dielectric>(1.5));
+  objects.Add(make_shared<ConstantMedium>(boundary, .0001, Color(1, 1, 1)));
+
+  auto e_mat = make_shared<Lambertian>(
+      make_shared<ImageTexture>("resources/earth-map.jpg"));
+  objects.Add(make_shared<Sphere>(Point3(400, 200, 400), 100, e_mat));
+  auto per_text = make_shared<NoiseTexture>(0.1);
+  objects.Add(make_shared<Sphere>(Point3(220, 280, 300), 80,
+                                  make_shared<Lambertian>(per_text)));
+
+  HittableList boxes2;
+  auto white = make_shared<Lambertian>(Color(.73, .73, .73));
+  int ns = 1000;
+  for (int j = 0; j < ns; j++) {
+    boxes2.Add(make_shared<Sphere>(Point3::Random(0, 165), 10, white));
+  }
+
+  objects.Add(make_shared<Instance>(
+      MakeBvh(boxes2, 0.0, 1.0),
+      Transform::Translation(Vec3(-100, 270, 395)) *
+          Transform::RotationY(15)));
+
+  objects.camera_ = std::make_shared<Camera>(
+      Point3(478, 278, -600), Point3(278, 278, 0), camera->v_up_, 40, 1.0,
+      camera->aperture_, camera->focus_dist_, Color(0, 0, 0), 0, 1);
+
+  return objects;
+}
+
+// A field of copies of one cluster of spheres. The cluster's BVH is built
+// once and every copy is an Instance of it, placed by a BVH over the
+// instances, so the scene holds 1600 clusters for the memory of one.
+HittableList Instances(const std::shared_ptr<Camera>& camera) {
+  HittableList cluster;
+  for (int i = 0; i < 500; i++) {
+    auto albedo = Color::Random(0.2, 0.9);
+    cluster.Add(make_shared<Sphere>(Point3::Random(-1, 1), 0.15,
+                                    make_shared<Lambertian>(albedo)));
+  }
+  auto cluster_bvh = MakeBvh(cluster, 0, 1);
+
+  HittableList instances;
+  for (int i = -20; i < 20; i++) {
+    for (int j = -20; j < 20; j++) {
+      auto scale = RandomDouble(0.5, 1.2);
+      auto x = 3 * i + RandomDouble(0, 1);
+      auto z = 3 * j + RandomDouble(0, 1);
+      auto angle = RandomDouble(0, 360);
+      instances.Add(make_shared<Instance>(
+          cluster_bvh, Transform::Translation(Vec3(x, scale, z)) *
+                           Transform::RotationY(angle) *
+                           Transform::Scaling(Vec3(scale, scale, scale))));
+    }
+  }
+
+  HittableList objects;
+  objects.Add(MakeBvh(instances, 0, 1));
+  objects.Add(make_shared<Sphere>(
+      Point3(0, -1000, 0), 1000,
+      make_shared<Lambertian>(Color(0.5, 0.5, 0.5))));
+
+  objects.camera_ = std::make_shared<Camera>(
+      Point3(0, 30, 75), Point3(0, 0, 0), camera->v_up_, 35,
+      camera->aspect_ratio_, 0.0, camera->focus_dist_,
+      Color(0.70, 0.80, 1.00));
+
+  return objects;
+}
+
+// A torus around the y axis as `rings` x `sides` quads split into
+// triangles, with smooth normals and uvs going around each circle.
+MeshData MakeTorusMesh(double major_radius, double minor_radius, int rings,
+                       int sides) {
+  MeshData mesh;
+  for (int i = 0; i <= rings; ++i) {
+    auto theta = 2 * pi * i / rings;
+    for (int j = 0; j <= sides; ++j) {
+      auto phi = 2 * pi * j / sides;
+      Vec3 normal(cos(phi) * cos(theta), sin(phi), cos(phi) * sin(theta));
+      Point3 center(major_radius * cos(theta), 0, major_radius * sin(theta));
+      auto position = center + minor_radius * normal;
+      for (int a = 0; a < 3; ++a) {
+        mesh.positions.push_back(static_cast<float>(position[a]));
+        mesh.normals.push_back(static_cast<float>(normal[a]));
+      }
+      mesh.uvs.push_back(static_cast<float>(i) / static_cast<float>(rings));
+      mesh.uvs.push_back(static_cast<float>(j) / static_cast<float>(sides));
+    }
+  }
+  auto vertex = [sides](int i, int j) {
+    return static_cast<uint32_t>(i * (sides + 1) + j);
+  };
+  for (int i = 0; i < rings; ++i) {
+    for (int j = 0; j < sides; ++j) {
+      mesh.indices.insert(mesh.indices.end(),
+                          {vertex(i, j), vertex(i, j + 1), vertex(i + 1, j),
+                           vertex(i + 1, j), vertex(i, j + 1),
+                           vertex(i + 1, j + 1)});
+    }
+  }
+  return mesh;
+}
+
+// Triangle meshes: a checkered torus lying on the ground, and two upright
+// instances of one metal torus mesh standing on either side of it.
+HittableList Meshes(const std::shared_ptr<Camera>& camera) {
+  HittableList objects;
+  auto checker =
+      make_shared<CheckTexture>(make_shared<SolidColor>(0.8f, 0.3f, 0.1f),
+                                make_shared<SolidColor>(0.9f, 0.9f, 0.9f));
+  objects.Add(make_shared<Sphere>(
+      Point3(0, -1000, 0), 1000,
+      make_shared<Lambertian>(Color(0.5, 0.5, 0.5))));
+  auto checkered = make_shared<TriangleMesh>(MakeTorusMesh(2, 0.6, 256, 64),
+                                             make_shared<Lambertian>(checker));
+  objects.Add(make_shared<Instance>(checkered,
+                                    Transform::Translation(Vec3(0, 0.6, 0))));
+
+  auto metal = make_shared<TriangleMesh>(MakeTorusMesh(1.5, 0.3, 128, 32),
+                                         make_shared<Metal>(
+                                             Color(0.8, 0.8, 0.9), 0.05));
+  objects.Add(make_shared<Instance>(
+      metal, Transform::Translation(Vec3(3.5, 1.9, 0)) *
+                 Transform::RotationZ(90)));
+  objects.Add(make_shared<Instance>(
+      metal, Transform::Translation(Vec3(-3.5, 1.9, 0)) *
+                 Transform::RotationZ(90)));
+
+  objects.camera_ = std::make_shared<Camera>(
+      Point3(0, 6, 10), Point3(0, 0.5, 0), camera->v_up_, 35,
+      camera->aspect_ratio_, 0.0, camera->focus_dist_,
+      Color(0.70, 0.80, 1.00));
+  return objects;
+}
+
+// The mesh in the OBJ or PLY file at `path`, standing on the ground and
+// framed by the camera. Empty when the file cannot be loaded.
+HittableList MeshFile(const std::shared_ptr<Camera>& camera,
+                      const std::string& path) {
+  HittableList objects;
+  MeshData data;
+  if (!LoadMesh(path, &data)) {
+    return objects;
+  }
+  auto mesh = make_shared<TriangleMesh>(
+      std::move(data), make_shared<Lambertian>(Color(0.7, 0.7, 0.7)));
+  Aabb box;
+  if (!mesh->BoundingBox(0, 1, &box)) {
+    return objects;
+  }
+  auto size = (box.Maximum() - box.Minimum()).Length();
+  auto center = 0.5 * (box.Minimum() + box.Maximum());
+  objects.Add(mesh);
+  objects.Add(make_shared<Sphere>(
+      Point3(center.X(), box.Minimum().Y() - 1000 * size, center.Z()),
+      1000 * size, make_shared<Lambertian>(Color(0.5, 0.5, 0.5))));
+
+  objects.camera_ = std::make_shared<Camera>(
+      center + size * Vec3(0.6, 0.5, 1.2), center, camera->v_up_, 35,
+      camera->aspect_ratio_, 0.0, size, Color(0.70, 0.80, 1.00));
+  return objects;
+}
+
+#pragma endregion  // RAY_TRACING_ONE_WEEK_SCENES_H
@@ -1,5 +1,9 @@
 #pragma once
+#include <bit>
+
 #include "rtweekend.h"
+#include "utility/ray_packet.h"
+#include "utility/stats.h"
 
 class Aabb {
  public:
@@ -13,6 +17,7 @@ class Aabb {
   [[nodiscard]] Point3 Maximum() const { return this->maximum_; }
 
   [[nodiscard]] bool Hit(const Ray& r, double t_min, double t_max) const {
+    RT_STATS_ADD(aabb_tests, 1);
     for (int a = 0; a < 3; a++) {
       auto t0 = fmin((minimum_[a] - r.Origin()[a]) / r.Direction()[a],
                      (maximum_[a] - r.Origin()[a]) / r.Direction()[a]);
@@ -27,6 +32,40 @@ class Aabb {
     return true;
   }
 
+  // Slab test of the packet lanes selected by `active`, each clipped to
+  // [t_min, t_max[lane]], kSimdWidth lanes at a time. Returns the mask of
+  // lanes that hit the box; a lane hits exactly when Hit would return true.
+  [[nodiscard]] unsigned int HitPacket(const RayPacket& packet,
+                                       unsigned int active, double t_min,
+                                       const double* t_max) const {
+    constexpr unsigned int kChunkMask = (1u << kSimdWidth) - 1;
+    RT_STATS_ADD(aabb_tests, std::popcount(active));
+    unsigned int hits = 0;
+    for (int base = 0; base < kPacketSize; base += kSimdWidth) {
+      if (((active >> base) & kChunkMask) == 0) {
+        continue;
+      }
+      auto lo = SimdDouble::Broadcast(t_min);
+      auto hi = SimdDouble::Load(t_max + base);
+      for (int a = 0; a < 3; a++) {
+        auto origin = SimdDouble::Load(packet.origin[a] + base);
+        auto direction = SimdDouble::Load(packet.direction[a] + base);
+        auto t0 = (SimdDouble::Broadcast(minimum_[a]) - origin) / direction;
+        auto t1 = (SimdDouble::Broadcast(maximum_[a]) - origin) / direction;
+        lo = Max(Min(t0, t1), lo);
+        hi = Min(Max(t0, t1), hi);
+      }
+      hits |= (lo < hi).Bits() << base;
+    }
+    return hits & active;
+  }
+
+  [[nodiscard]] double SurfaceArea() const {
+    auto extent = maximum_ - minimum_;
+    return 2 * (extent.X() * extent.Y() + extent.Y() * extent.Z() +
+                extent.Z() * extent.X());
+  }
+
   [[nodiscard]] static Aabb SurroundingBox(const Aabb& box0, const Aabb& box1) {
     auto small = Point3(fmin(box0.minimum_.X(), box1.minimum_.X()),
                         fmin(box0.minimum_.Y(), box1.minimum_.Y()),
@@ -1,25 +1,57 @@
 #pragma once
 
-#include <iostream>
-
 #include "utility/rtweekend.h"
+#include "utility/simd.h"
 #include "utility/vec3.h"
 
-void write_color(std::ostream& out, Color pixel_color, int samples_per_pixel) {
-  auto r = pixel_color.X();
-  auto g = pixel_color.Y();
-  auto b = pixel_color.Z();
+// Maps the sum of a pixel channel's samples to an 8-bit display value: divide
+// by the number of samples the pixel took and gamma-correct for gamma=2.0.
+inline unsigned char TonemapChannel(double sum, int sample_count) {
+  auto scale = 1.0 / sample_count;
+  auto value = sqrt(scale * sum);
+  return static_cast<unsigned char>(
+      static_cast<int>(256 * Clamp(value, 0.0f, 0.999f)));
+}
+
+// Tonemaps a row of `width` pixels into interleaved 8-bit RGB, kSimdWidth
+// channels at a time. sample_counts holds the number of samples each pixel
+// actually took, which varies when adaptive sampling is enabled.
+void TonemapRow(const Color* row, const int* sample_counts, int width,
+                unsigned char* out) {
+  static_assert(sizeof(Color) == 3 * sizeof(double));
+  const auto* sums = reinterpret_cast<const double*>(row);
+  alignas(64) double scales[kSimdWidth];
+  alignas(64) double mapped[kSimdWidth];
+  auto channel_count = 3 * width;
 
-  // Divide the color by the number of samples and gamma-correct for gamma=2.0.
-  auto scale = 1.0 / samples_per_pixel;
-  r = sqrt(scale * r);
-  g = sqrt(scale * g);
-  b = sqrt(scale * b);
+  int c = 0;
+  for (; c + kSimdWidth <= channel_count; c += kSimdWidth) {
+    for (int k = 0; k < kSimdWidth; ++k) {
+      scales[k] = 1.0 / sample_counts[(c + k) / 3];
+    }
+    auto value = Sqrt(SimdDouble::Load(scales) * SimdDouble::Load(sums + c));
+    value = Min(Max(value, SimdDouble::Broadcast(0.0f)),
+                SimdDouble::Broadcast(0.999f));
+    (SimdDouble::Broadcast(256) * value).Store(mapped);
+    for (int k = 0; k < kSimdWidth; ++k) {
+      out[c + k] = static_cast<unsigned char>(static_cast<int>(mapped[k]));
+    }
+  }
+  for (; c < channel_count; ++c) {
+    out[c] = TonemapChannel(sums[c], sample_counts[c / 3]);
+  }
+}
 
-  // Write the translated [0,255] value of each color component.ß
-  out << static_cast<int>(256 * Clamp(r, 0.0f, 0.999f)) << ' '
-      << static_cast<int>(256 * Clamp(g, 0.0f, 0.999f)) << ' '
-      << static_cast<int>(256 * Clamp(b, 0.0f, 0.999f)) << '\n';
+// Converts a row of sums into the linear average radiance of each pixel, for
+// the floating point output formats.
+void ResolveRow(const Color* row, const int* sample_counts, int width,
+                float* out) {
+  for (int i = 0; i < width; ++i) {
+    auto scale = 1.0 / sample_counts[i];
+    for (int channel = 0; channel < 3; ++channel) {
+      out[3 * i + channel] = static_cast<float>(scale * row[i][channel]);
+    }
+  }
 }
 
 #pragma endregion
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <bit>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb/stb_image_write.h"
+#include "utility/color.h"
+
+enum class ImageFormat {
+  kPpm,  // binary P6, 8-bit gamma 2
+  kPng,  // 8-bit gamma 2, through stb_image_write
+  kPfm,  // 32-bit float linear radiance
+};
+
+bool ParseImageFormat(const std::string& name, ImageFormat* format) {
+  if (name == "ppm") {
+    *format = ImageFormat::kPpm;
+  } else if (name == "png") {
+    *format = ImageFormat::kPng;
+  } else if (name == "pfm") {
+    *format = ImageFormat::kPfm;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+std::string ImageExtension(ImageFormat format) {
+  switch (format) {
+    case ImageFormat::kPpm:
+      return ".ppm";
+    case ImageFormat::kPng:
+      return ".png";
+    case ImageFormat::kPfm:
+      return ".pfm";
+  }
+  return "";
+}
+
+// A rendered frame: per pixel, the sum of its samples and how many it took.
+// Row 0 is the bottom of the image.
+struct Image {
+  int width{};
+  int height{};
+  std::vector<Color> sums;
+  std::vector<int> sample_counts;
+};
+
+// Encodes and writes images on a background thread, so that rendering of
+// the next frame or job can start while the previous one is being written.
+class ImageWriter {
+ public:
+  ImageWriter() : thread_(&ImageWriter::Run, this) {}
+  ~ImageWriter() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    wake_.notify_all();
+    thread_.join();
+  }
+
+  ImageWriter(const ImageWriter&) = delete;
+  ImageWriter& operator=(const ImageWriter&) = delete;
+
+  // Queues the image to be written to `filename` and returns immediately.
+  void Submit(std::string filename, ImageFormat format, Image image);
+  // Blocks until every submitted image has been written.
+  void Finish();
+
+  static bool Write(const std::string& filename, ImageFormat format,
+                    const Image& image);
+
+ private:
+  struct Job {
+    std::string filename;
+    ImageFormat format;
+    Image image;
+  };
+
+  void Run();
+  static bool WritePpm(const std::string& filename, const Image& image);
+  static bool WritePng(const std::string& filename, const Image& image);
+  static bool WritePfm(const std::string& filename, const Image& image);
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable idle_;
+  std::deque<Job> jobs_;
+  bool busy_{};
+  bool stopping_{};
+  std::thread thread_;
+};
+
+void ImageWriter::Submit(std::string filename, ImageFormat format,
+                         Image image) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_.push_back({std::move(filename), format, std::move(image)});
+  }
+  wake_.notify_one();
+}
+
+void ImageWriter::Finish() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_.wait(lock, [this] { return jobs_.empty() && !busy_; });
+}
+
+void ImageWriter::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    wake_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+    if (jobs_.empty()) {
+      return;
+    }
+    auto job = std::move(jobs_.front());
+    jobs_.pop_front();
+    busy_ = true;
+
+    lock.unlock();
+    if (!Write(job.filename, job.format, job.image)) {
+      std::cerr << "ERROR: Could not write image file '" << job.filename
+                << "'." << std::endl;
+    }
+    lock.lock();
+
+    busy_ = false;
+    idle_.notify_all();
+  }
+}
+
+bool ImageWriter::Write(const std::string& filename, ImageFormat format,
+                        const Image& image) {
+  switch (format) {
+    case ImageFormat::kPpm:
+      return WritePpm(filename, image);
+    case ImageFormat::kPng:
+      return WritePng(filename, image);
+    case ImageFormat::kPfm:
+      return WritePfm(filename, image);
+  }
+  return false;
+}
+
+bool ImageWriter::WritePpm(const std::string& filename, const Image& image) {
+  std::ofstream ofs(filename, std::ios::binary);
+  ofs << "P6\n" << image.width << ' ' << image.height << "\n255\n";
+
+  std::vector<unsigned char> row(3 * image.width);
+  for (int j = image.height - 1; j >= 0; --j) {
+    TonemapRow(&image.sums[j * image.width],
+               &image.sample_counts[j * image.width], image.width, row.data());
+    ofs.write(reinterpret_cast<const char*>(row.data()),
+              static_cast<std::streamsize>(row.size()));
+  }
+  return static_cast<bool>(ofs);
+}
+
+bool ImageWriter::WritePng(const std::string& filename, const Image& image) {
+  auto stride = 3 * image.width;
+  std::vector<unsigned char> pixels(stride * image.height);
+  for (int j = image.height - 1; j >= 0; --j) {
+    TonemapRow(&image.sums[j * image.width],
+               &image.sample_counts[j * image.width], image.width,
+               &pixels[(image.height - 1 - j) * stride]);
+  }
+  return stbi_write_png(filename.c_str(), image.width, image.height, 3,
+                        pixels.data(), stride) != 0;
+}
+
+bool ImageWriter::WritePfm(const std::string& filename, const Image& image) {
+  std::ofstream ofs(filename, std::ios::binary);
+  // A negative scale marks little-endian samples. PFM stores rows bottom to
+  // top, the same order as the frame buffer.
+  ofs << "PF\n"
+      << image.width << ' ' << image.height << '\n'
+      << (std::endian::native == std::endian::little ? "-1.0" : "1.0")
+      << '\n';
+
+  std::vector<float> row(3 * image.width);
+  for (int j = 0; j < image.height; ++j) {
+    ResolveRow(&image.sums[j * image.width],
+               &image.sample_counts[j * image.width], image.width, row.data());
+    ofs.write(reinterpret_cast<const char*>(row.data()),
+              static_cast<std::streamsize>(row.size() * sizeof(float)));
+  }
+  return static_cast<bool>(ofs);
+}
+
+#pragma endregion  // RAY_TRACING_ONE_WEEK_IMAGE_WRITER_H
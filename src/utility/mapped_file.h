@@ -0,0 +1,52 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <string>
+
+// A file mapped read-only into memory for the lifetime of the object.
+class MappedFile {
+ public:
+  // Maps `path`; Data() is null when the file cannot be opened or mapped.
+  explicit MappedFile(const std::string& path);
+  ~MappedFile();
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  [[nodiscard]] const std::byte* Data() const { return data_; }
+  [[nodiscard]] size_t Size() const { return size_; }
+
+ private:
+  const std::byte* data_{};
+  size_t size_{};
+};
+
+MappedFile::MappedFile(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return;
+  }
+  struct stat status {};
+  if (fstat(fd, &status) == 0 && status.st_size > 0) {
+    auto size = static_cast<size_t>(status.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+      data_ = static_cast<const std::byte*>(data);
+      size_ = size;
+    }
+  }
+  // The mapping stays valid after the descriptor is closed.
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr) {
+    munmap(const_cast<std::byte*>(data_), size_);
+  }
+}
+
+#pragma endregion  // RAY_TRACING_ONE_WEEK_MAPPED_FILE_H
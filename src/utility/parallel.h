@@ -0,0 +1,33 @@
+#pragma once
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// Splits [begin, end) into thread_count contiguous chunks of nearly equal
+// size (fewer if the range is shorter than that) and calls
+// fn(chunk, chunk_begin, chunk_end) for each of them on its own thread,
+// chunk 0 on the calling thread. Returns once every chunk is done, so fn can
+// write per-chunk results for the caller to merge.
+template <typename Fn>
+void ParallelFor(long begin, long end, int thread_count, Fn&& fn) {
+  thread_count = static_cast<int>(
+      std::clamp<long>(thread_count, 1, std::max(end - begin, 1L)));
+  auto chunk_begin = [&](int chunk) {
+    return begin + (end - begin) * chunk / thread_count;
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(thread_count - 1);
+  for (int chunk = 1; chunk < thread_count; ++chunk) {
+    auto first = chunk_begin(chunk);
+    auto last = chunk_begin(chunk + 1);
+    threads.emplace_back([&fn, chunk, first, last] { fn(chunk, first, last); });
+  }
+  fn(0, begin, chunk_begin(1));
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+#pragma endregion  // RAY_TRACING_ONE_WEEK_PARALLEL_H
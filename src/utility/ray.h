@@ -1,16 +1,24 @@
 #pragma once
 
+#include "utility/sampler.h"
 #include "utility/vec3.h"
 
 class Ray {
  public:
   Ray() = default;
-  Ray(const Point3& origin, const Vec3& direction, double time)
-      : origin_(origin), direction_(direction), time_(time) {}
+  Ray(const Point3& origin, const Vec3& direction, double time,
+      Sampler* sampler = nullptr)
+      : origin_(origin),
+        direction_(direction),
+        time_(time),
+        sampler_(sampler) {}
 
   [[nodiscard]] Point3 Origin() const { return this->origin_; }
   [[nodiscard]] Vec3 Direction() const { return this->direction_; }
   [[nodiscard]] double Time() const { return this->time_; }
+  // Random stream of the path this ray belongs to, for hittables such as
+  // ConstantMedium whose intersection is stochastic.
+  [[nodiscard]] Sampler* GetSampler() const { return this->sampler_; }
 
   [[nodiscard]] Point3 At(double t) const {
     return this->origin_ + t * this->direction_;
@@ -20,5 +28,6 @@ class Ray {
   Point3 origin_;
   Vec3 direction_;
   double time_{};
+  Sampler* sampler_{};
 };
 #pragma endregion
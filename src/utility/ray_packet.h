@@ -0,0 +1,42 @@
+#pragma once
+
+#include "utility/ray.h"
+#include "utility/simd.h"
+
+// Number of rays traced together as a packet. A multiple of every kSimdWidth.
+const int kPacketSize = 8;
+
+// A group of coherent rays (e.g. camera rays of one pixel) stored both as Rays,
+// for hittables without a packet kernel, and as structure-of-arrays lanes
+// that SIMD kernels load kSimdWidth at a time. Lanes at and above size are
+// padding and are never reported as hits.
+struct RayPacket {
+  Ray rays[kPacketSize];
+  alignas(64) double origin[3][kPacketSize];
+  alignas(64) double direction[3][kPacketSize];
+  int size{};
+
+  void Add(const Ray& ray) {
+    rays[size] = ray;
+    for (int axis = 0; axis < 3; ++axis) {
+      origin[axis][size] = ray.Origin()[axis];
+      direction[axis][size] = ray.Direction()[axis];
+    }
+    ++size;
+  }
+
+  // Copies the last ray into the padding lanes so that kernels only ever see
+  // well-formed rays.
+  void Pad() {
+    for (int lane = size; lane < kPacketSize; ++lane) {
+      for (int axis = 0; axis < 3; ++axis) {
+        origin[axis][lane] = origin[axis][size - 1];
+        direction[axis][lane] = direction[axis][size - 1];
+      }
+    }
+  }
+
+  [[nodiscard]] unsigned int ActiveMask() const { return (1u << size) - 1; }
+};
+
+#pragma endregion  // RAY_TRACING_ONE_WEEK_RAY_PACKET_H
@@ -4,7 +4,8 @@
 #include <cstdlib>
 #include <limits>
 #include <memory>
-#include <random>
+
+#include "utility/sampler.h"
 
 // Using
 
@@ -21,10 +22,12 @@ const double pi = 3.14159265358979323846;
 
 // double RandomDouble() { return rand() / (RAND_MAX + 1.0); }
 
+// Random numbers for building scenes. Rendering draws from the per-path
+// Sampler instead, so this stream is only advanced while a scene is built and
+// every run builds the same scene.
 double RandomDouble() {
-  static std::uniform_real_distribution<double> distribution(0.0, 1.0);
-  static std::mt19937 generator(std::random_device{}());
-  return distribution(generator);
+  thread_local Sampler scene_sampler(~0u, 0);
+  return scene_sampler.Next();
 }
 
 double RandomDouble(double min, double max) {
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+
+// Counter-based random number generator (Philox4x32-10). Every value is a
+// pure function of (pixel, sample, bounce, dimension), so a path draws the
+// same numbers no matter which thread renders it or in which order, and
+// there is no shared generator state for threads to fight over.
+class Sampler {
+ public:
+  Sampler() = default;
+  Sampler(uint32_t pixel, uint32_t sample) : pixel_(pixel), sample_(sample) {}
+
+  // Starts the stream of a new path vertex; dimensions restart from zero so
+  // bounce n of a path does not depend on how many numbers bounce n-1 drew.
+  void SetBounce(uint32_t bounce) {
+    bounce_ = bounce;
+    dimension_ = 0;
+  }
+
+  // Uniform double in [0, 1).
+  double Next() {
+    // Each Philox block yields 128 bits: two doubles with 53 bits each.
+    if ((dimension_ & 1) == 0) {
+      Philox(dimension_ >> 1, block_);
+    }
+    auto word = dimension_++ & 1;
+    auto bits = (static_cast<uint64_t>(block_[2 * word]) << 21) ^
+                (block_[2 * word + 1] >> 11);
+    return static_cast<double>(bits) * 0x1.0p-53;
+  }
+
+  // Uniform double in [min, max).
+  double Next(double min, double max) { return min + (max - min) * Next(); }
+
+ private:
+  void Philox(uint32_t block, uint32_t out[4]) const {
+    constexpr uint32_t kMultiplier0 = 0xD2511F53;
+    constexpr uint32_t kMultiplier1 = 0xCD9E8D57;
+    constexpr uint32_t kWeyl0 = 0x9E3779B9;
+    constexpr uint32_t kWeyl1 = 0xBB67AE85;
+    constexpr int kRounds = 10;
+
+    uint32_t c[4] = {block, bounce_, sample_, pixel_};
+    uint32_t k[2] = {kKey0, kKey1};
+    for (int round = 0; round < kRounds; ++round) {
+      auto p0 = static_cast<uint64_t>(kMultiplier0) * c[0];
+      auto p1 = static_cast<uint64_t>(kMultiplier1) * c[2];
+      uint32_t next[4] = {static_cast<uint32_t>(p1 >> 32) ^ c[1] ^ k[0],
+                          static_cast<uint32_t>(p1),
+                          static_cast<uint32_t>(p0 >> 32) ^ c[3] ^ k[1],
+                          static_cast<uint32_t>(p0)};
+      c[0] = next[0];
+      c[1] = next[1];
+      c[2] = next[2];
+      c[3] = next[3];
+      k[0] += kWeyl0;
+      k[1] += kWeyl1;
+    }
+    out[0] = c[0];
+    out[1] = c[1];
+    out[2] = c[2];
+    out[3] = c[3];
+  }
+
+  static constexpr uint32_t kKey0 = 0x2545F491;
+  static constexpr uint32_t kKey1 = 0x9E3779B9;
+
+  uint32_t pixel_{};
+  uint32_t sample_{};
+  uint32_t bounce_{};
+  uint32_t dimension_{};
+  uint32_t block_[4]{};
+};
+
+#pragma endregion  // RAY_TRACING_ONE_WEEK_SAMPLER_H
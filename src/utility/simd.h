@@ -0,0 +1,220 @@
+#pragma once
+
+#include <cmath>
+
+#if defined(__AVX512F__) || defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Thin wrapper over the widest double-precision vector unit the compiler
+// targets: AVX-512 (8 lanes), AVX/AVX2 (4 lanes), SSE2 (2 lanes) or plain
+// scalar code (1 lane). Kernels are written once against SimdDouble and
+// SimdMask and loop over kSimdWidth-wide chunks of their data. Build with
+// -DRT_NATIVE=ON to let the compiler use the host CPU's widest unit.
+#if defined(__AVX512F__)
+
+const int kSimdWidth = 8;
+
+struct SimdMask {
+  __mmask8 m;
+  [[nodiscard]] unsigned int Bits() const { return m; }
+};
+
+struct SimdDouble {
+  __m512d v;
+
+  static SimdDouble Load(const double* p) { return {_mm512_loadu_pd(p)}; }
+  static SimdDouble Broadcast(double x) { return {_mm512_set1_pd(x)}; }
+  void Store(double* p) const { _mm512_storeu_pd(p, v); }
+};
+
+inline SimdDouble operator+(SimdDouble a, SimdDouble b) {
+  return {_mm512_add_pd(a.v, b.v)};
+}
+inline SimdDouble operator-(SimdDouble a, SimdDouble b) {
+  return {_mm512_sub_pd(a.v, b.v)};
+}
+inline SimdDouble operator*(SimdDouble a, SimdDouble b) {
+  return {_mm512_mul_pd(a.v, b.v)};
+}
+inline SimdDouble operator/(SimdDouble a, SimdDouble b) {
+  return {_mm512_div_pd(a.v, b.v)};
+}
+inline SimdDouble Min(SimdDouble a, SimdDouble b) {
+  return {_mm512_min_pd(a.v, b.v)};
+}
+inline SimdDouble Max(SimdDouble a, SimdDouble b) {
+  return {_mm512_max_pd(a.v, b.v)};
+}
+inline SimdDouble Sqrt(SimdDouble a) { return {_mm512_sqrt_pd(a.v)}; }
+inline SimdMask operator<(SimdDouble a, SimdDouble b) {
+  return {_mm512_cmp_pd_mask(a.v, b.v, _CMP_LT_OQ)};
+}
+inline SimdMask operator<=(SimdDouble a, SimdDouble b) {
+  return {_mm512_cmp_pd_mask(a.v, b.v, _CMP_LE_OQ)};
+}
+inline SimdMask operator>=(SimdDouble a, SimdDouble b) {
+  return {_mm512_cmp_pd_mask(a.v, b.v, _CMP_GE_OQ)};
+}
+inline SimdMask operator&(SimdMask a, SimdMask b) {
+  return {static_cast<__mmask8>(a.m & b.m)};
+}
+inline SimdMask operator|(SimdMask a, SimdMask b) {
+  return {static_cast<__mmask8>(a.m | b.m)};
+}
+inline SimdDouble Select(SimdMask m, SimdDouble a, SimdDouble b) {
+  return {_mm512_mask_blend_pd(m.m, b.v, a.v)};
+}
+
+#elif defined(__AVX__)
+
+const int kSimdWidth = 4;
+
+struct SimdMask {
+  __m256d m;
+  [[nodiscard]] unsigned int Bits() const { return _mm256_movemask_pd(m); }
+};
+
+struct SimdDouble {
+  __m256d v;
+
+  static SimdDouble Load(const double* p) { return {_mm256_loadu_pd(p)}; }
+  static SimdDouble Broadcast(double x) { return {_mm256_set1_pd(x)}; }
+  void Store(double* p) const { _mm256_storeu_pd(p, v); }
+};
+
+inline SimdDouble operator+(SimdDouble a, SimdDouble b) {
+  return {_mm256_add_pd(a.v, b.v)};
+}
+inline SimdDouble operator-(SimdDouble a, SimdDouble b) {
+  return {_mm256_sub_pd(a.v, b.v)};
+}
+inline SimdDouble operator*(SimdDouble a, SimdDouble b) {
+  return {_mm256_mul_pd(a.v, b.v)};
+}
+inline SimdDouble operator/(SimdDouble a, SimdDouble b) {
+  return {_mm256_div_pd(a.v, b.v)};
+}
+inline SimdDouble Min(SimdDouble a, SimdDouble b) {
+  return {_mm256_min_pd(a.v, b.v)};
+}
+inline SimdDouble Max(SimdDouble a, SimdDouble b) {
+  return {_mm256_max_pd(a.v, b.v)};
+}
+inline SimdDouble Sqrt(SimdDouble a) { return {_mm256_sqrt_pd(a.v)}; }
+inline SimdMask operator<(SimdDouble a, SimdDouble b) {
+  return {_mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ)};
+}
+inline SimdMask operator<=(SimdDouble a, SimdDouble b) {
+  return {_mm256_cmp_pd(a.v, b.v, _CMP_LE_OQ)};
+}
+inline SimdMask operator>=(SimdDouble a, SimdDouble b) {
+  return {_mm256_cmp_pd(a.v, b.v, _CMP_GE_OQ)};
+}
+inline SimdMask operator&(SimdMask a, SimdMask b) {
+  return {_mm256_and_pd(a.m, b.m)};
+}
+inline SimdMask operator|(SimdMask a, SimdMask b) {
+  return {_mm256_or_pd(a.m, b.m)};
+}
+inline SimdDouble Select(SimdMask m, SimdDouble a, SimdDouble b) {
+  return {_mm256_blendv_pd(b.v, a.v, m.m)};
+}
+
+#elif defined(__SSE2__)
+
+const int kSimdWidth = 2;
+
+struct SimdMask {
+  __m128d m;
+  [[nodiscard]] unsigned int Bits() const { return _mm_movemask_pd(m); }
+};
+
+struct SimdDouble {
+  __m128d v;
+
+  static SimdDouble Load(const double* p) { return {_mm_loadu_pd(p)}; }
+  static SimdDouble Broadcast(double x) { return {_mm_set1_pd(x)}; }
+  void Store(double* p) const { _mm_storeu_pd(p, v); }
+};
+
+inline SimdDouble operator+(SimdDouble a, SimdDouble b) {
+  return {_mm_add_pd(a.v, b.v)};
+}
+inline SimdDouble operator-(SimdDouble a, SimdDouble b) {
+  return {_mm_sub_pd(a.v, b.v)};
+}
+inline SimdDouble operator*(SimdDouble a, SimdDouble b) {
+  return {_mm_mul_pd(a.v, b.v)};
+}
+inline SimdDouble operator/(SimdDouble a, SimdDouble b) {
+  return {_mm_div_pd(a.v, b.v)};
+}
+inline SimdDouble Min(SimdDouble a, SimdDouble b) {
+  return {_mm_min_pd(a.v, b.v)};
+}
+inline SimdDouble Max(SimdDouble a, SimdDouble b) {
+  return {_mm_max_pd(a.v, b.v)};
+}
+inline SimdDouble Sqrt(SimdDouble a) { return {_mm_sqrt_pd(a.v)}; }
+inline SimdMask operator<(SimdDouble a, SimdDouble b) {
+  return {_mm_cmplt_pd(a.v, b.v)};
+}
+inline SimdMask operator<=(SimdDouble a, SimdDouble b) {
+  return {_mm_cmple_pd(a.v, b.v)};
+}
+inline SimdMask operator>=(SimdDouble a, SimdDouble b) {
+  return {_mm_cmpge_pd(a.v, b.v)};
+}
+inline SimdMask operator&(SimdMask a, SimdMask b) {
+  return {_mm_and_pd(a.m, b.m)};
+}
+inline SimdMask operator|(SimdMask a, SimdMask b) {
+  return {_mm_or_pd(a.m, b.m)};
+}
+inline SimdDouble Select(SimdMask m, SimdDouble a, SimdDouble b) {
+  return {_mm_or_pd(_mm_and_pd(m.m, a.v), _mm_andnot_pd(m.m, b.v))};
+}
+
+#else
+
+const int kSimdWidth = 1;
+
+struct SimdMask {
+  bool m;
+  [[nodiscard]] unsigned int Bits() const { return m ? 1 : 0; }
+};
+
+struct SimdDouble {
+  double v;
+
+  static SimdDouble Load(const double* p) { return {*p}; }
+  static SimdDouble Broadcast(double x) { return {x}; }
+  void Store(double* p) const { *p = v; }
+};
+
+inline SimdDouble operator+(SimdDouble a, SimdDouble b) { return {a.v + b.v}; }
+inline SimdDouble operator-(SimdDouble a, SimdDouble b) { return {a.v - b.v}; }
+inline SimdDouble operator*(SimdDouble a, SimdDouble b) { return {a.v * b.v}; }
+inline SimdDouble operator/(SimdDouble a, SimdDouble b) { return {a.v / b.v}; }
+// Same operand convention as the vector units: the second operand wins when
+// either is NaN.
+inline SimdDouble Min(SimdDouble a, SimdDouble b) {
+  return {a.v < b.v ? a.v : b.v};
+}
+inline SimdDouble Max(SimdDouble a, SimdDouble b) {
+  return {a.v > b.v ? a.v : b.v};
+}
+inline SimdDouble Sqrt(SimdDouble a) { return {std::sqrt(a.v)}; }
+inline SimdMask operator<(SimdDouble a, SimdDouble b) { return {a.v < b.v}; }
+inline SimdMask operator<=(SimdDouble a, SimdDouble b) { return {a.v <= b.v}; }
+inline SimdMask operator>=(SimdDouble a, SimdDouble b) { return {a.v >= b.v}; }
+inline SimdMask operator&(SimdMask a, SimdMask b) { return {a.m && b.m}; }
+inline SimdMask operator|(SimdMask a, SimdMask b) { return {a.m || b.m}; }
+inline SimdDouble Select(SimdMask m, SimdDouble a, SimdDouble b) {
+  return m.m ? a : b;
+}
+
+#endif
+
+#pragma endregion  // RAY_TRACING_ONE_WEEK_SIMD_H
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include "material/material.h"
+
+// Primitives whose intersection tests are counted separately.
+enum class PrimitiveType {
+  kSphere,
+  kMovingSphere,
+  kXyRectangle,
+  kXzRectangle,
+  kYzRectangle,
+  kConstantMedium,
+  kTriangle,
+  kBox,
+};
+const int kPrimitiveTypeCount = 8;
+
+// Paths deeper than this are counted in the last bucket.
+const int kStatsMaxDepth = 64;
+
+struct RenderStats {
+  long rays_by_depth[kStatsMaxDepth]{};
+  long bvh_nodes_visited{};
+  long aabb_tests{};
+  long primitive_tests[kPrimitiveTypeCount]{};
+  // Hits whose point, normal, UV and material were computed, one per
+  // closest hit rather than per primitive hit along the way.
+  long hits_completed{};
+  long scatters[kMaterialTypeCount]{};
+  double bvh_build_seconds{};
+
+  [[nodiscard]] long Rays() const;
+  RenderStats& operator+=(const RenderStats& other);
+};
+
+long RenderStats::Rays() const {
+  long rays = 0;
+  for (auto count : rays_by_depth) {
+    rays += count;
+  }
+  return rays;
+}
+
+RenderStats& RenderStats::operator+=(const RenderStats& other) {
+  for (int depth = 0; depth < kStatsMaxDepth; ++depth) {
+    rays_by_depth[depth] += other.rays_by_depth[depth];
+  }
+  bvh_nodes_visited += other.bvh_nodes_visited;
+  aabb_tests += other.aabb_tests;
+  for (int type = 0; type < kPrimitiveTypeCount; ++type) {
+    primitive_tests[type] += other.primitive_tests[type];
+  }
+  hits_completed += other.hits_completed;
+  for (int type = 0; type < kMaterialTypeCount; ++type) {
+    scatters[type] += other.scatters[type];
+  }
+  bvh_build_seconds += other.bvh_build_seconds;
+  return *this;
+}
+
+// Owns the counters of every thread that has counted something.
+class Stats {
+ public:
+  // The calling thread's counters.
+  static RenderStats& Local() {
+    thread_local RenderStats* local = Register();
+    return *local;
+  }
+
+  // Sums the counters of every thread. Only meaningful once the threads that
+  // count have finished or are idle.
+  static RenderStats Collect() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    RenderStats total;
+    for (const auto& stats : threads_) {
+      total += *stats;
+    }
+    return total;
+  }
+
+ private:
+  static RenderStats* Register() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    threads_.push_back(std::make_unique<RenderStats>());
+    return threads_.back().get();
+  }
+
+  // Counters outlive their threads so that Collect still sees them.
+  static inline std::mutex mutex_;
+  static inline std::vector<std::unique_ptr<RenderStats>> threads_;
+};
+
+// Adds the time until it goes out of scope to a counter in seconds. Nested
+// timers on the same thread, such as recursive BVH node constructors, only
+// count once: the outermost one records.
+class StatsTimer {
+ public:
+  explicit StatsTimer(double* seconds)
+      : seconds_(seconds),
+        outermost_(depth_++ == 0),
+        start_(std::chrono::steady_clock::now()) {}
+  ~StatsTimer() {
+    if (--depth_ == 0 && outermost_) {
+      *seconds_ += std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start_)
+                       .count();
+    }
+  }
+
+  StatsTimer(const StatsTimer&) = delete;
+  StatsTimer& operator=(const StatsTimer&) = delete;
+
+ private:
+  static inline thread_local int depth_ = 0;
+  double* seconds_;
+  bool outermost_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+// Counting hot-path events. Every thread counts into its own
+// RenderStats, which Stats::Collect sums once the threads are done, so
+// counting costs a thread-local increment and no synchronization. Counters
+// only exist when built with -DRT_STATS=ON (which defines RT_ENABLE_STATS);
+// otherwise RT_STATS_ADD expands to nothing and production renders pay
+// nothing for them.
+#ifdef RT_ENABLE_STATS
+#define RT_STATS_ADD(counter, amount) (Stats::Local().counter += (amount))
+#define RT_STATS_TIME(counter) \
+  StatsTimer stats_timer_##counter(&Stats::Local().counter)
+#else
+#define RT_STATS_ADD(counter, amount) ((void)0)
+#define RT_STATS_TIME(counter) ((void)0)
+#endif
+
+#define RT_STATS_RAY(depth) \
+  RT_STATS_ADD(rays_by_depth[std::min((depth), kStatsMaxDepth - 1)], 1)
+
+// Wall-clock durations of the phases of a render, measured by main.
+struct PhaseTimes {
+  double scene_build{};
+  double render{};
+  double output{};
+};
+
+// Writes the counters and timings as a JSON object. Scene build time
+// includes the BVH build, which is also reported on its own.
+void WriteStatsJson(std::ostream& out, const RenderStats& stats,
+                    const PhaseTimes& times) {
+  static const char* const kPrimitiveNames[kPrimitiveTypeCount] = {
+      "sphere",       "moving_sphere",   "xy_rectangle", "xz_rectangle",
+      "yz_rectangle", "constant_medium", "triangle",     "box"};
+  static const char* const kMaterialNames[kMaterialTypeCount] = {
+      "lambertian", "metal", "dielectric", "isotropic", "diffuse_light",
+      "other"};
+
+  auto rays = stats.Rays();
+  auto last_depth = kStatsMaxDepth;
+  while (last_depth > 0 && stats.rays_by_depth[last_depth - 1] == 0) {
+    --last_depth;
+  }
+
+  out << "{\n";
+  out << "  \"seconds\": {\"scene_build\": " << times.scene_build
+      << ", \"bvh_build\": " << stats.bvh_build_seconds
+      << ", \"render\": " << times.render << ", \"output\": " << times.output
+      << "},\n";
+  out << "  \"rays\": " << rays << ",\n";
+  out << "  \"mrays_per_second\": "
+      << (times.render > 0 ? rays / times.render * 1e-6 : 0) << ",\n";
+  out << "  \"rays_by_depth\": [";
+  for (int depth = 0; depth < last_depth; ++depth) {
+    out << (depth > 0 ? ", " : "") << stats.rays_by_depth[depth];
+  }
+  out << "],\n";
+  out << "  \"bvh_nodes_visited\": " << stats.bvh_nodes_visited << ",\n";
+  out << "  \"aabb_tests\": " << stats.aabb_tests << ",\n";
+  out << "  \"primitive_tests\": {";
+  for (int type = 0; type < kPrimitiveTypeCount; ++type) {
+    out << (type > 0 ? ", " : "") << '"' << kPrimitiveNames[type]
+        << "\": " << stats.primitive_tests[type];
+  }
+  out << "},\n";
+  out << "  \"hits_completed\": " << stats.hits_completed << ",\n";
+  out << "  \"scatters\": {";
+  for (int type = 0; type < kMaterialTypeCount; ++type) {
+    out << (type > 0 ? ", " : "") << '"' << kMaterialNames[type]
+        << "\": " << stats.scatters[type];
+  }
+  out << "}\n";
+  out << "}\n";
+}
+
+#pragma endregion  // RAY_TRACING_ONE_WEEK_STATS_H
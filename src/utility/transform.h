@@ -0,0 +1,203 @@
+#pragma once
+
+#include <cmath>
+
+#include "utility/aabb.h"
+#include "utility/rtweekend.h"
+#include "utility/vec3.h"
+
+// An affine transform as a 3x4 matrix, kept together with its inverse so
+// that both directions cost one matrix product. Transforms compose like
+// matrices: (a * b) applies b first.
+class Transform {
+ public:
+  // The identity.
+  Transform();
+
+  static Transform Translation(const Vec3& offset);
+  static Transform Scaling(const Vec3& factors);
+  // Rotations by `degrees` about the coordinate axes, counterclockwise when
+  // looking down the axis towards the origin. RotationY matches RotateY.
+  static Transform RotationX(double degrees);
+  static Transform RotationY(double degrees);
+  static Transform RotationZ(double degrees);
+
+  [[nodiscard]] Transform Inverse() const;
+
+  [[nodiscard]] Point3 ApplyToPoint(const Point3& p) const {
+    return Apply(matrix_, p, 1);
+  }
+  [[nodiscard]] Vec3 ApplyToVector(const Vec3& v) const {
+    return Apply(matrix_, v, 0);
+  }
+  // Normals transform by the inverse transpose; the result is not
+  // normalized.
+  [[nodiscard]] Vec3 ApplyToNormal(const Vec3& n) const;
+  [[nodiscard]] Point3 InverseApplyToPoint(const Point3& p) const {
+    return Apply(inverse_, p, 1);
+  }
+  [[nodiscard]] Vec3 InverseApplyToVector(const Vec3& v) const {
+    return Apply(inverse_, v, 0);
+  }
+
+  // The box around the transformed corners of `box`.
+  [[nodiscard]] Aabb ApplyToBox(const Aabb& box) const;
+
+  friend Transform operator*(const Transform& a, const Transform& b);
+
+ private:
+  using Matrix = double[3][4];
+
+  // Fills inverse_ from the linear part and translation of matrix_.
+  void ComputeInverse();
+  static Vec3 Apply(const Matrix& m, const Vec3& v, double w) {
+    return {m[0][0] * v[0] + m[0][1] * v[1] + m[0][2] * v[2] + m[0][3] * w,
+            m[1][0] * v[0] + m[1][1] * v[1] + m[1][2] * v[2] + m[1][3] * w,
+            m[2][0] * v[0] + m[2][1] * v[1] + m[2][2] * v[2] + m[2][3] * w};
+  }
+
+  Matrix matrix_;
+  Matrix inverse_;
+};
+
+Transform::Transform() {
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      matrix_[i][j] = i == j ? 1 : 0;
+      inverse_[i][j] = i == j ? 1 : 0;
+    }
+  }
+}
+
+Transform Transform::Translation(const Vec3& offset) {
+  Transform t;
+  for (int i = 0; i < 3; ++i) {
+    t.matrix_[i][3] = offset[i];
+    t.inverse_[i][3] = -offset[i];
+  }
+  return t;
+}
+
+Transform Transform::Scaling(const Vec3& factors) {
+  Transform t;
+  for (int i = 0; i < 3; ++i) {
+    t.matrix_[i][i] = factors[i];
+    t.inverse_[i][i] = 1 / factors[i];
+  }
+  return t;
+}
+
+Transform Transform::RotationX(double degrees) {
+  auto radians = DegreesToRadians(degrees);
+  Transform t;
+  t.matrix_[1][1] = std::cos(radians);
+  t.matrix_[1][2] = -std::sin(radians);
+  t.matrix_[2][1] = std::sin(radians);
+  t.matrix_[2][2] = std::cos(radians);
+  t.ComputeInverse();
+  return t;
+}
+
+Transform Transform::RotationY(double degrees) {
+  auto radians = DegreesToRadians(degrees);
+  Transform t;
+  t.matrix_[0][0] = std::cos(radians);
+  t.matrix_[0][2] = std::sin(radians);
+  t.matrix_[2][0] = -std::sin(radians);
+  t.matrix_[2][2] = std::cos(radians);
+  t.ComputeInverse();
+  return t;
+}
+
+Transform Transform::RotationZ(double degrees) {
+  auto radians = DegreesToRadians(degrees);
+  Transform t;
+  t.matrix_[0][0] = std::cos(radians);
+  t.matrix_[0][1] = -std::sin(radians);
+  t.matrix_[1][0] = std::sin(radians);
+  t.matrix_[1][1] = std::cos(radians);
+  t.ComputeInverse();
+  return t;
+}
+
+Transform Transform::Inverse() const {
+  Transform t;
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      t.matrix_[i][j] = inverse_[i][j];
+      t.inverse_[i][j] = matrix_[i][j];
+    }
+  }
+  return t;
+}
+
+Vec3 Transform::ApplyToNormal(const Vec3& n) const {
+  const auto& m = inverse_;
+  return {m[0][0] * n[0] + m[1][0] * n[1] + m[2][0] * n[2],
+          m[0][1] * n[0] + m[1][1] * n[1] + m[2][1] * n[2],
+          m[0][2] * n[0] + m[1][2] * n[1] + m[2][2] * n[2]};
+}
+
+Aabb Transform::ApplyToBox(const Aabb& box) const {
+  Point3 min(infinity, infinity, infinity);
+  Point3 max(-infinity, -infinity, -infinity);
+  for (int corner = 0; corner < 8; ++corner) {
+    Point3 p((corner & 1) != 0 ? box.Maximum().X() : box.Minimum().X(),
+             (corner & 2) != 0 ? box.Maximum().Y() : box.Minimum().Y(),
+             (corner & 4) != 0 ? box.Maximum().Z() : box.Minimum().Z());
+    auto transformed = ApplyToPoint(p);
+    for (int a = 0; a < 3; ++a) {
+      min[a] = fmin(min[a], transformed[a]);
+      max[a] = fmax(max[a], transformed[a]);
+    }
+  }
+  return {min, max};
+}
+
+Transform operator*(const Transform& a, const Transform& b) {
+  // Products of the matrices, treating them as 4x4 with a last row of
+  // (0, 0, 0, 1); the inverse of a product is the reversed product of the
+  // inverses.
+  auto multiply = [](const Transform::Matrix& x, const Transform::Matrix& y,
+                     Transform::Matrix& result) {
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 4; ++j) {
+        result[i][j] = x[i][0] * y[0][j] + x[i][1] * y[1][j] +
+                       x[i][2] * y[2][j] + (j == 3 ? x[i][3] : 0);
+      }
+    }
+  };
+  Transform t;
+  multiply(a.matrix_, b.matrix_, t.matrix_);
+  multiply(b.inverse_, a.inverse_, t.inverse_);
+  return t;
+}
+
+void Transform::ComputeInverse() {
+  const auto& m = matrix_;
+  // Inverse of the linear part from its cofactors.
+  double cofactor[3][3];
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      auto r0 = (i + 1) % 3;
+      auto r1 = (i + 2) % 3;
+      auto c0 = (j + 1) % 3;
+      auto c1 = (j + 2) % 3;
+      cofactor[i][j] = m[r0][c0] * m[r1][c1] - m[r0][c1] * m[r1][c0];
+    }
+  }
+  auto determinant = m[0][0] * cofactor[0][0] + m[0][1] * cofactor[0][1] +
+                     m[0][2] * cofactor[0][2];
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      inverse_[i][j] = cofactor[j][i] / determinant;
+    }
+  }
+  // The inverse moves points back by the translation, in the rotated frame.
+  for (int i = 0; i < 3; ++i) {
+    inverse_[i][3] = -(inverse_[i][0] * m[0][3] + inverse_[i][1] * m[1][3] +
+                       inverse_[i][2] * m[2][3]);
+  }
+}
+
+#pragma endregion  // RAY_TRACING_ONE_WEEK_TRANSFORM_H
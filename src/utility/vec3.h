@@ -3,6 +3,8 @@
 #include <cmath>
 #include <iostream>
 
+#include "utility/sampler.h"
+
 using std::sqrt;
 
 class Vec3 {
@@ -60,17 +62,18 @@ using Point3 = Vec3;
 using Color = Vec3;
 
 // Vec3 Utility Functions
-Vec3 RandomInUnitSphere() {
+Vec3 RandomInUnitSphere(Sampler* sampler) {
   while (true) {
-    auto p = Vec3::Random(-1, 1);
+    auto p = Vec3(sampler->Next(-1, 1), sampler->Next(-1, 1),
+                  sampler->Next(-1, 1));
     if (p.LengthSquared() >= 1) continue;
     return p;
   }
 }
 
-Vec3 RandomInUnitDisk() {
+Vec3 RandomInUnitDisk(Sampler* sampler) {
   while (true) {
-    auto p = Vec3(RandomDouble(-1, 1), RandomDouble(-1, 1), 0);
+    auto p = Vec3(sampler->Next(-1, 1), sampler->Next(-1, 1), 0);
     if (p.LengthSquared() >= 1) continue;
     return p;
   }
@@ -112,7 +115,9 @@ inline Vec3 cross(const Vec3& u, const Vec3& v) {
 
 inline Vec3 UnitVector(Vec3 v) { return v / v.Length(); }
 
-Vec3 RandomUnitVector() { return UnitVector(RandomInUnitSphere()); }
+Vec3 RandomUnitVector(Sampler* sampler) {
+  return UnitVector(RandomInUnitSphere(sampler));
+}
 
 Vec3 Reflect(const Vec3& v, const Vec3& n) { return v - 2 * Dot(v, n) * n; }
 